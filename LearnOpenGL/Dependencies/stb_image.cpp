@@ -1,2 +1,7 @@
 #define STB_IMAGE_IMPLEMENTATION
-#include "stb_image.h"
\ No newline at end of file
+#include "stb_image.h"
+
+// The SSE2 IDCT and color conversion are picked automatically on x86 and x64, make sure nothing turns them off
+#if (defined(_M_IX86) || defined(_M_X64) || defined(__SSE2__)) && !defined(STBI_SSE2)
+#error "stb_image was built without its SSE2 decode paths"
+#endif
@@ -0,0 +1,1375 @@
+#include "Benchmarks.h"
+#include "CameraUniforms.h"
+#include "FrameDataRing.h"
+#include "Frustum.h"
+#include "GLState.h"
+#include "IndirectDrawQueue.h"
+#include "MappedFile.h"
+#include "MeshCache.h"
+#include "MeshImport.h"
+#include "MipGenerator.h"
+#include "Model.h"
+#include "RenderQueue.h"
+#include "SceneGraph.h"
+#include "Shader.h"
+#include "TextureCache.h"
+#include "TextureCooker.h"
+#include "TextureLoader.h"
+#include "TextureStreamer.h"
+#include "TextureUploadRing.h"
+#include "../Dependencies/stb_image.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <glm/gtc/matrix_transform.hpp>
+#include <iostream>
+#include <map>
+#include <new>
+#include <set>
+#include <string>
+
+// With BENCHMARK_COUNT_ALLOCATIONS defined every heap allocation in the process is counted, so the import benchmark can
+// report allocations per mesh. It replaces the global operator new for the whole executable, so only the Benchmark
+// configuration defines it.
+#ifdef BENCHMARK_COUNT_ALLOCATIONS
+static std::atomic<size_t> allocationCount{ 0 };
+
+void* operator new(const std::size_t size)
+{
+	allocationCount.fetch_add(1, std::memory_order_relaxed);
+	if (void* memory = std::malloc(size ? size : 1))
+		return memory;
+	throw std::bad_alloc();
+}
+
+void operator delete(void* memory) noexcept
+{
+	std::free(memory);
+}
+
+void operator delete(void* memory, std::size_t) noexcept
+{
+	std::free(memory);
+}
+#endif
+
+namespace
+{
+	const char* const NANOSUIT_PATH = "resources/objects/nanosuit/nanosuit.obj";
+	// the gamma correction Main loads nanosuit with, cooked textures have to match it to be used
+	const bool NANOSUIT_GAMMA = false;
+
+	size_t AllocationCount()
+	{
+#ifdef BENCHMARK_COUNT_ALLOCATIONS
+		return allocationCount.load(std::memory_order_relaxed);
+#else
+		return 0;
+#endif
+	}
+
+	// ", n allocations" since the given count, nothing when allocations aren't counted
+	std::string AllocationsSince(const size_t before)
+	{
+#ifdef BENCHMARK_COUNT_ALLOCATIONS
+		return ", " + std::to_string(AllocationCount() - before) + " allocations";
+#else
+		static_cast<void>(before);
+		return std::string();
+#endif
+	}
+
+	void PrintLoadStats(const char* label, const ModelLoadStats& stats)
+	{
+		std::cout << label << (stats.cacheHit ? " (cache hit)" : " (cache miss)")
+			<< ": geometry " << stats.geometryMs << " ms, textures " << stats.textureMs
+			<< " ms, total " << stats.totalMs << " ms, index memory " << stats.indexBytes32 / 1024 << " KB as 32-bit, "
+			<< stats.indexBytes / 1024 << " KB uploaded" << std::endl;
+	}
+
+	// Cold load has to go through Assimp and rebuild the mesh cache, warm load reads the cache back.
+	// The second warm load runs while another instance is alive, so all of its textures come from the texture cache.
+	int BenchmarkModelLoad()
+	{
+		std::remove(MeshCache::CachePath(NANOSUIT_PATH).c_str());
+
+		{
+			const Model cold(NANOSUIT_PATH);
+			PrintLoadStats("cold", cold.GetLoadStats());
+		}
+		const Model warm(NANOSUIT_PATH);
+		PrintLoadStats("warm", warm.GetLoadStats());
+		const Model shared(NANOSUIT_PATH);
+		PrintLoadStats("warm, textures shared", shared.GetLoadStats());
+
+		const TextureCache& textures = TextureCache::Get();
+		std::cout << "texture cache: " << textures.Hits() << " hits, " << textures.Misses() << " misses, "
+			<< textures.ResidentCount() << " resident" << std::endl;
+		return warm.GetLoadStats().cacheHit ? 0 : 1;
+	}
+
+	template <typename Function>
+	double TimeMilliseconds(Function function)
+	{
+		const auto start = std::chrono::steady_clock::now();
+		function();
+		glFinish();
+		return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	}
+
+	void DeleteTextures(std::vector<unsigned int>& ids)
+	{
+		GLState::Get().DeleteTextures(static_cast<GLsizei>(ids.size()), ids.data());
+		ids.clear();
+	}
+
+	// Decodes and uploads every nanosuit texture serially on this thread, then through the worker pool
+	int BenchmarkTextureDecode()
+	{
+		const Model model(NANOSUIT_PATH);
+		std::set<std::string> files;
+		for (const Texture& texture : model.GetLoadedTextures())
+			files.insert(model.GetDirectory() + '/' + texture.path);
+
+		std::vector<unsigned int> ids;
+		const double serialMs = TimeMilliseconds([&]
+		{
+			for (const std::string& file : files)
+				ids.push_back(TextureLoader::LoadImmediate(file));
+		});
+		DeleteTextures(ids);
+
+		const double parallelMs = TimeMilliseconds([&]
+		{
+			TextureLoader loader;
+			for (const std::string& file : files)
+				ids.push_back(loader.Load(file));
+			loader.Finish();
+		});
+		DeleteTextures(ids);
+
+		std::cout << files.size() << " textures, serial " << serialMs << " ms, parallel (" << ThreadPool::Shared().ThreadCount()
+			<< " workers) " << parallelMs << " ms, speedup " << serialMs / parallelMs << "x" << std::endl;
+		return 0;
+	}
+
+	// every nanosuit texture file with the material slot it is used in
+	std::map<std::string, std::string> NanosuitTextureFiles()
+	{
+		const Model model(NANOSUIT_PATH);
+		std::map<std::string, std::string> files;
+		for (const Texture& texture : model.GetLoadedTextures())
+			files[model.GetDirectory() + '/' + texture.path] = texture.type;
+		return files;
+	}
+
+	const char* BlockFormatName(const BlockFormat format)
+	{
+		switch (format)
+		{
+		case BlockFormat::BC1: return "BC1";
+		case BlockFormat::BC3: return "BC3";
+		default: return "BC5";
+		}
+	}
+
+	// Compresses every nanosuit texture into its cooked KTX file and checks the quality with the CPU decoder
+	int CookTextures()
+	{
+		size_t uncompressedBytes = 0, compressedBytes = 0;
+		double encodeMs = 0.0;
+		for (const auto& file : NanosuitTextureFiles())
+		{
+			TextureCookReport report;
+			if (!TextureCooker::Cook(file.first, file.second == "texture_normal", Model::IsSrgbTexture(file.second, NANOSUIT_GAMMA), ThreadPool::Shared(),
+				&report))
+				return 1;
+			std::cout << file.first << ": " << report.width << "x" << report.height << " " << BlockFormatName(report.format) << ", "
+				<< report.uncompressedBytes / 1024 << " KB -> " << report.compressedBytes / 1024 << " KB, encode " << report.encodeMs
+				<< " ms, PSNR " << report.psnr << " dB" << std::endl;
+			uncompressedBytes += report.uncompressedBytes;
+			compressedBytes += report.compressedBytes;
+			encodeMs += report.encodeMs;
+		}
+		std::cout << "total " << uncompressedBytes / (1024 * 1024) << " MB -> " << compressedBytes / (1024 * 1024) << " MB, encode "
+			<< encodeMs << " ms on " << ThreadPool::Shared().ThreadCount() + 1 << " threads" << std::endl;
+		return 0;
+	}
+
+	// Loads every nanosuit texture from the source images and from the cooked files, run --cook-textures first
+	int BenchmarkCompressedTextures()
+	{
+		if (!TextureLoader::SupportsCookedTextures())
+		{
+			std::cout << "GL_EXT_texture_compression_s3tc is not supported" << std::endl;
+			return 1;
+		}
+
+		const std::map<std::string, std::string> files = NanosuitTextureFiles();
+		for (const bool useCooked : { false, true })
+		{
+			std::vector<unsigned int> ids;
+			size_t uploadedBytes = 0;
+			const double loadMs = TimeMilliseconds([&]
+			{
+				TextureLoader loader(ThreadPool::Shared(), useCooked);
+				for (const auto& file : files)
+					ids.push_back(loader.Load(file.first, Model::IsSrgbTexture(file.second, NANOSUIT_GAMMA)));
+				loader.Finish();
+				uploadedBytes = loader.UploadedBytes();
+			});
+			DeleteTextures(ids);
+			std::cout << (useCooked ? "cooked" : "source") << ": " << files.size() << " textures in " << loadMs << " ms, "
+				<< uploadedBytes / (1024 * 1024) << " MB of texture memory" << std::endl;
+		}
+		return 0;
+	}
+
+	// Decodes every bundled image from a filename through stb's stdio reader and from a mapping of the file,
+	// reporting the throughput per format in MB of compressed input per second
+	int BenchmarkImageDecode()
+	{
+		const int repetitions = 5;
+		std::map<std::string, std::string> files = NanosuitTextureFiles();
+		for (const char* file : { "resources/Logo.jpg", "resources/awesomeface.png", "resources/container.jpg", "resources/container2.png",
+			"resources/container2_specular.png", "resources/wall.jpg" })
+			files[file] = "";
+
+		struct FormatStats
+		{
+			size_t files = 0;
+			size_t fileBytes = 0;
+			double stdioMs = 0.0, mappedMs = 0.0;
+		};
+		std::map<std::string, FormatStats> formats;
+		for (const auto& file : files)
+		{
+			const std::string& path = file.first;
+			const size_t dot = path.find_last_of('.');
+			FormatStats& stats = formats[dot == std::string::npos ? "?" : path.substr(dot + 1)];
+
+			int width, height, numComponents;
+			const auto start = std::chrono::steady_clock::now();
+			for (int i = 0; i < repetitions; i++)
+				stbi_image_free(stbi_load(path.c_str(), &width, &height, &numComponents, 4));
+			const auto middle = std::chrono::steady_clock::now();
+			size_t fileBytes = 0;
+			for (int i = 0; i < repetitions; i++)
+			{
+				const MappedFile source(path);
+				if (!source.IsOpen())
+					return 1;
+				fileBytes = source.Size();
+				stbi_image_free(stbi_load_from_memory(source.Data(), static_cast<int>(source.Size()), &width, &height, &numComponents, 4));
+			}
+			const auto end = std::chrono::steady_clock::now();
+
+			stats.files++;
+			stats.fileBytes += fileBytes * repetitions;
+			stats.stdioMs += std::chrono::duration<double, std::milli>(middle - start).count();
+			stats.mappedMs += std::chrono::duration<double, std::milli>(end - middle).count();
+		}
+
+		for (const auto& format : formats)
+		{
+			const FormatStats& stats = format.second;
+			const double megabytes = stats.fileBytes / (1024.0 * 1024.0);
+			std::cout << format.first << ": " << stats.files << " files, stdio " << megabytes / (stats.stdioMs / 1000.0) << " MB/s, mapped "
+				<< megabytes / (stats.mappedMs / 1000.0) << " MB/s" << std::endl;
+		}
+		return 0;
+	}
+
+	// Builds the mip chain of every nanosuit texture with the driver and with both CPU filters on this thread
+	int BenchmarkMipGeneration()
+	{
+		double driverMs = 0.0, boxMs = 0.0, kaiserMs = 0.0;
+		const std::map<std::string, std::string> files = NanosuitTextureFiles();
+		for (const auto& file : files)
+		{
+			const MappedFile source(file.first);
+			int width, height, numComponents;
+			unsigned char* pixels = source.IsOpen()
+				? stbi_load_from_memory(source.Data(), static_cast<int>(source.Size()), &width, &height, &numComponents, 4)
+				: nullptr;
+			if (!pixels)
+				return 1;
+			const bool srgb = file.second == "texture_diffuse";
+
+			// the driver path stalls the GL thread, the CPU path runs on a loader worker in practice
+			unsigned int id;
+			glGenTextures(1, &id);
+			GLState::Get().BindTexture(id);
+			driverMs += TimeMilliseconds([&]
+			{
+				glTexImage2D(GL_TEXTURE_2D, 0, srgb ? GL_SRGB8_ALPHA8 : GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+				glGenerateMipmap(GL_TEXTURE_2D);
+			});
+			GLState::Get().DeleteTexture(id);
+
+			boxMs += TimeMilliseconds([&] { GenerateMipChain(pixels, width, height, srgb, MipFilter::Box); });
+			kaiserMs += TimeMilliseconds([&] { GenerateMipChain(pixels, width, height, srgb, MipFilter::Kaiser); });
+			stbi_image_free(pixels);
+		}
+		std::cout << files.size() << " textures, driver upload + glGenerateMipmap " << driverMs << " ms, CPU box " << boxMs
+			<< " ms, CPU Kaiser " << kaiserMs << " ms" << std::endl;
+		return 0;
+	}
+
+	// Grid of gridSize x gridSize vertices, two triangles per cell
+	void BuildSyntheticMesh(const unsigned int gridSize, aiMesh& mesh)
+	{
+		mesh.mPrimitiveTypes = aiPrimitiveType_TRIANGLE;
+		mesh.mNumVertices = gridSize * gridSize;
+		mesh.mVertices = new aiVector3D[mesh.mNumVertices];
+		mesh.mNormals = new aiVector3D[mesh.mNumVertices];
+		mesh.mTextureCoords[0] = new aiVector3D[mesh.mNumVertices];
+		mesh.mTangents = new aiVector3D[mesh.mNumVertices];
+		mesh.mBitangents = new aiVector3D[mesh.mNumVertices];
+		for (unsigned int y = 0; y < gridSize; y++)
+		{
+			for (unsigned int x = 0; x < gridSize; x++)
+			{
+				const unsigned int i = y * gridSize + x;
+				mesh.mVertices[i] = aiVector3D(static_cast<float>(x), 0.0f, static_cast<float>(y));
+				mesh.mNormals[i] = aiVector3D(0.0f, 1.0f, 0.0f);
+				mesh.mTextureCoords[0][i] = aiVector3D(x / static_cast<float>(gridSize), y / static_cast<float>(gridSize), 0.0f);
+				mesh.mTangents[i] = aiVector3D(1.0f, 0.0f, 0.0f);
+				mesh.mBitangents[i] = aiVector3D(0.0f, 0.0f, 1.0f);
+			}
+		}
+
+		const unsigned int cells = gridSize - 1;
+		mesh.mNumFaces = cells * cells * 2;
+		mesh.mFaces = new aiFace[mesh.mNumFaces];
+		for (unsigned int y = 0; y < cells; y++)
+		{
+			for (unsigned int x = 0; x < cells; x++)
+			{
+				const unsigned int corner = y * gridSize + x;
+				const unsigned int corners[2][3] = {
+					{ corner, corner + gridSize, corner + 1 },
+					{ corner + 1, corner + gridSize, corner + gridSize + 1 },
+				};
+				for (unsigned int t = 0; t < 2; t++)
+				{
+					aiFace& face = mesh.mFaces[(y * cells + x) * 2 + t];
+					face.mNumIndices = 3;
+					face.mIndices = new unsigned int[3]{ corners[t][0], corners[t][1], corners[t][2] };
+				}
+			}
+		}
+	}
+
+	// The per-element push_back conversion the importer used before the bulk path, kept as the baseline
+	void ImportPerElement(const aiMesh& mesh, std::vector<Vertex>& vertices, std::vector<unsigned int>& indices)
+	{
+		for (unsigned int i = 0; i < mesh.mNumVertices; i++)
+		{
+			Vertex vertex{};
+			vertex.position = glm::vec3(mesh.mVertices[i].x, mesh.mVertices[i].y, mesh.mVertices[i].z);
+			vertex.normal = glm::vec3(mesh.mNormals[i].x, mesh.mNormals[i].y, mesh.mNormals[i].z);
+			vertex.texCoords = glm::vec2(mesh.mTextureCoords[0][i].x, mesh.mTextureCoords[0][i].y);
+			vertex.tangent = glm::vec3(mesh.mTangents[i].x, mesh.mTangents[i].y, mesh.mTangents[i].z);
+			vertex.bitangent = glm::vec3(mesh.mBitangents[i].x, mesh.mBitangents[i].y, mesh.mBitangents[i].z);
+			vertices.push_back(vertex);
+		}
+		for (unsigned int i = 0; i < mesh.mNumFaces; i++)
+		{
+			const aiFace face = mesh.mFaces[i];
+			for (unsigned int j = 0; j < face.mNumIndices; j++)
+				indices.push_back(face.mIndices[j]);
+		}
+	}
+
+	template <typename Import>
+	void ReportImport(const char* label, const aiMesh& mesh, Import import)
+	{
+		std::vector<Vertex> vertices;
+		std::vector<unsigned int> indices;
+		const size_t allocationsBefore = AllocationCount();
+		const auto start = std::chrono::steady_clock::now();
+		import(vertices, indices);
+		const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		const std::string allocations = AllocationsSince(allocationsBefore);
+
+		std::cout << label << ": " << seconds * 1000.0 << " ms, " << mesh.mNumVertices / seconds / 1.0e6
+			<< " M vertices/s" << allocations << std::endl;
+	}
+
+	// Converts a synthetic mesh of several million triangles and uploads it, to measure the import path in isolation
+	int BenchmarkMeshImport()
+	{
+		aiMesh mesh;
+		BuildSyntheticMesh(1600, mesh);
+		std::cout << mesh.mNumVertices << " vertices, " << mesh.mNumFaces << " triangles" << std::endl;
+
+		ReportImport("per element", mesh, [&](std::vector<Vertex>& vertices, std::vector<unsigned int>& indices)
+		{
+			ImportPerElement(mesh, vertices, indices);
+		});
+		ReportImport("bulk", mesh, [&](std::vector<Vertex>& vertices, std::vector<unsigned int>& indices)
+		{
+			ImportVertices(mesh, vertices);
+			ImportIndices(mesh, indices);
+		});
+
+		// the converted arrays are moved through Mesh into the upload without another copy
+		const size_t allocationsBefore = AllocationCount();
+		const double uploadMs = TimeMilliseconds([&]
+		{
+			std::vector<Vertex> vertices;
+			std::vector<unsigned int> indices;
+			ImportVertices(mesh, vertices);
+			ImportIndices(mesh, indices);
+			const Mesh uploaded(std::move(vertices), std::move(indices), {});
+		});
+		std::cout << "bulk import + upload: " << uploadMs << " ms" << AllocationsSince(allocationsBefore) << std::endl;
+		return 0;
+	}
+
+	// Forces a fresh import with the optimization stage enabled, which prints ACMR and ATVR per mesh
+	int BenchmarkMeshOptimize()
+	{
+		std::remove(MeshCache::CachePath(NANOSUIT_PATH).c_str());
+
+		ModelSettings settings;
+		settings.optimizeMeshes = true;
+		const Model model(NANOSUIT_PATH, false, settings);
+		PrintLoadStats("optimized", model.GetLoadStats());
+		return 0;
+	}
+
+	// Draws the nanosuit many times per frame and reports frame time and vertex memory
+	void BenchmarkModelDraws(const char* label, const ModelSettings& settings, const char* vertexShader)
+	{
+		const int drawsPerFrame = 200;
+		const int frames = 50;
+		const glm::mat4 projection = glm::perspective(glm::radians(45.0f), 16.0f / 9.0f, 0.1f, 100.0f);
+		const glm::vec3 eye(0.0f, 0.0f, 3.0f);
+		const glm::mat4 view = glm::lookAt(eye, glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+		const glm::mat4 transform = glm::scale(glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, -1.75f, 0.0f)), glm::vec3(0.2f));
+		GLState::Get().SetEnabled(GL_DEPTH_TEST, true);
+
+		Model model(NANOSUIT_PATH, false, settings);
+		const Shader shader(vertexShader, "Source/Shaders/ModelShader.frag");
+		CameraUniformBuffer camera;
+		camera.Update(view, projection, eye);
+		shader.Use();
+		FrameDataRing::Get().BindUniformBlock(OBJECT_BLOCK_BINDING, ObjectBlock{ transform });
+
+		// warm up driver side state before timing
+		model.Draw(shader);
+		const double totalMs = TimeMilliseconds([&]
+		{
+			for (int frame = 0; frame < frames; frame++)
+			{
+				glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+				for (int draw = 0; draw < drawsPerFrame; draw++)
+					model.Draw(shader);
+			}
+		});
+
+		std::cout << label << ": " << model.GetVertexBufferBytes() / 1024 << " KB vertex data, "
+			<< totalMs / frames << " ms per frame of " << drawsPerFrame << " models" << std::endl;
+	}
+
+	int BenchmarkVertexFormats()
+	{
+		ModelSettings settings;
+		BenchmarkModelDraws("full", settings, "Source/Shaders/ModelShader.vert");
+		settings.vertexFormat = VertexFormat::Packed;
+		BenchmarkModelDraws("packed", settings, "Source/Shaders/ModelShaderPacked.vert");
+		return 0;
+	}
+
+	// Per-mesh VAOs against every mesh packed into one shared geometry buffer
+	int BenchmarkSharedGeometry()
+	{
+		ModelSettings settings;
+		BenchmarkModelDraws("vao per mesh", settings, "Source/Shaders/ModelShader.vert");
+		settings.packGeometry = true;
+		BenchmarkModelDraws("shared geometry", settings, "Source/Shaders/ModelShader.vert");
+		return 0;
+	}
+
+	// A row of nanosuits receding from the camera, drawn at full resolution and with distance based LOD selection
+	int BenchmarkLod()
+	{
+		const int instances = 100;
+		const int frames = 50;
+		const float fovY = glm::radians(45.0f);
+		const float viewportHeight = 720.0f;
+		const glm::vec3 eye(0.0f, 0.0f, 3.0f);
+		const glm::mat4 projection = glm::perspective(fovY, 16.0f / 9.0f, 0.1f, 500.0f);
+		const glm::mat4 view = glm::lookAt(eye, glm::vec3(0.0f, 0.0f, -1.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+		GLState::Get().SetEnabled(GL_DEPTH_TEST, true);
+
+		std::remove(MeshCache::CachePath(NANOSUIT_PATH).c_str());
+		ModelSettings settings;
+		settings.optimizeMeshes = true;
+		settings.lodErrors = { 0.002f, 0.01f, 0.04f };
+		Model model(NANOSUIT_PATH, false, settings);
+
+		const std::vector<size_t> lodTriangles = model.GetLodTriangleCounts();
+		for (size_t lod = 0; lod < lodTriangles.size(); lod++)
+			std::cout << "LOD " << lod << ": " << lodTriangles[lod] << " triangles" << std::endl;
+
+		const Shader shader("Source/Shaders/ModelShader.vert", "Source/Shaders/ModelShader.frag");
+		CameraUniformBuffer camera;
+		camera.Update(view, projection, eye);
+		shader.Use();
+
+		std::vector<glm::mat4> transforms(instances);
+		for (int i = 0; i < instances; i++)
+		{
+			const glm::vec3 offset((i % 2 ? 1.0f : -1.0f), -1.75f, -2.0f * static_cast<float>(i));
+			transforms[i] = glm::scale(glm::translate(glm::mat4(1.0f), offset), glm::vec3(0.2f));
+		}
+
+		const double fullMs = TimeMilliseconds([&]
+		{
+			for (int frame = 0; frame < frames; frame++)
+			{
+				glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+				for (const glm::mat4& transform : transforms)
+				{
+					FrameDataRing::Get().BindUniformBlock(OBJECT_BLOCK_BINDING, ObjectBlock{ transform });
+					model.Draw(shader);
+				}
+				FrameDataRing::Get().EndFrame();
+			}
+		});
+
+		const LodView lodView(eye, fovY, viewportHeight);
+		std::vector<ModelLodState> states(instances);
+		size_t lodTrianglesPerFrame = 0;
+		const double lodMs = TimeMilliseconds([&]
+		{
+			for (int frame = 0; frame < frames; frame++)
+			{
+				glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+				lodTrianglesPerFrame = 0;
+				for (int i = 0; i < instances; i++)
+					lodTrianglesPerFrame += model.Draw(shader, transforms[i], lodView, states[i]);
+			}
+		});
+
+		std::cout << instances << " instances, full resolution " << lodTriangles[0] * instances << " triangles " << fullMs / frames
+			<< " ms per frame, with LODs " << lodTrianglesPerFrame << " triangles " << lodMs / frames << " ms per frame" << std::endl;
+		return 0;
+	}
+
+	// Time the render thread is blocked by a synchronous load against the longest single frame of an asynchronous one
+	int BenchmarkAsyncLoad()
+	{
+		const double syncMs = TimeMilliseconds([] { const Model model(NANOSUIT_PATH); });
+
+		const auto start = std::chrono::steady_clock::now();
+		std::shared_ptr<Model> model = Model::LoadAsync(NANOSUIT_PATH);
+		const double returnMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+		int frames = 0;
+		double worstFrameMs = 0.0;
+		bool loaded = false;
+		while (!loaded)
+		{
+			const double frameMs = TimeMilliseconds([&] { loaded = model->Update(); });
+			worstFrameMs = std::max(worstFrameMs, frameMs);
+			frames++;
+		}
+		const double totalMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+		std::cout << "sync load blocks " << syncMs << " ms, async returns in " << returnMs << " ms and loads over " << frames
+			<< " frames in " << totalMs << " ms, longest frame " << worstFrameMs << " ms" << std::endl;
+		return 0;
+	}
+
+	// Walks the camera up to the nanosuit with texture streaming, once with an ample budget and once with a tight one
+	int BenchmarkTextureStreaming()
+	{
+		const float fovY = glm::radians(45.0f);
+		const float viewportHeight = 1080.0f;
+		const glm::mat4 projection = glm::perspective(fovY, 16.0f / 9.0f, 0.1f, 500.0f);
+		const glm::mat4 transform = glm::scale(glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, -1.75f, 0.0f)), glm::vec3(0.2f));
+		GLState::Get().SetEnabled(GL_DEPTH_TEST, true);
+
+		const Shader shader("Source/Shaders/ModelShader.vert", "Source/Shaders/ModelShader.frag");
+		CameraUniformBuffer camera;
+		shader.Use();
+
+		TextureStreamer& streamer = TextureStreamer::Get();
+		const size_t defaultBudget = streamer.GetBudget();
+		for (const size_t budget : { defaultBudget, static_cast<size_t>(8 * 1024 * 1024) })
+		{
+			streamer.SetBudget(budget);
+			ModelSettings settings;
+			settings.streamTextures = true;
+			Model model(NANOSUIT_PATH, false, settings);
+			const TextureStreamingStats loaded = streamer.GetStats();
+			std::cout << "budget " << budget / (1024 * 1024) << " MB, after load " << loaded.residentBytes / 1024 << " KB resident of "
+				<< loaded.fullBytes / (1024 * 1024) << " MB" << std::endl;
+
+			ModelLodState state;
+			for (const float distance : { 40.0f, 10.0f, 3.0f, 1.0f })
+			{
+				const glm::vec3 eye(0.0f, 0.0f, distance);
+				camera.Update(glm::lookAt(eye, glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f)), projection, eye);
+				int frames = 0;
+				const double streamMs = TimeMilliseconds([&]
+				{
+					// until nothing is waiting any more or the budget stops it
+					for (; frames < 200; frames++)
+					{
+						glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+						model.Draw(shader, transform, LodView(eye, fovY, viewportHeight), state);
+						const size_t uploads = streamer.GetStats().uploads;
+						streamer.Update();
+						if (streamer.GetStats().uploads == uploads)
+							break;
+					}
+				});
+
+				const TextureStreamingStats stats = streamer.GetStats();
+				std::cout << "  distance " << distance << ": " << frames << " frames (" << streamMs << " ms) to settle, "
+					<< stats.residentBytes / 1024 << " KB resident, " << stats.residentLevels << "/" << stats.totalLevels << " levels, "
+					<< stats.waitingTextures << " textures waiting, " << stats.uploads << " uploads, " << stats.evictions
+					<< " evictions, latency " << stats.averageLatencyMs << " ms average " << stats.maxLatencyMs << " ms max" << std::endl;
+			}
+		}
+		streamer.SetBudget(defaultBudget);
+		return 0;
+	}
+
+	// Uploads the decoded mip chains of every nanosuit texture straight from client memory and through the PBO ring.
+	// Issue time is how long the GL thread is blocked in the upload calls, total time also waits for the GPU.
+	int BenchmarkTextureUpload()
+	{
+		struct Chain
+		{
+			std::vector<unsigned char> base;
+			int width, height;
+			std::vector<MipLevel> mips;
+		};
+		std::vector<Chain> chains;
+		size_t bytes = 0;
+		for (const auto& file : NanosuitTextureFiles())
+		{
+			int width, height, numComponents;
+			unsigned char* pixels = stbi_load(file.first.c_str(), &width, &height, &numComponents, 4);
+			if (!pixels)
+				return 1;
+			Chain chain{ std::vector<unsigned char>(pixels, pixels + static_cast<size_t>(width) * height * 4), width, height,
+				GenerateMipChain(pixels, width, height, false) };
+			stbi_image_free(pixels);
+			bytes += chain.base.size();
+			for (const MipLevel& mip : chain.mips)
+				bytes += mip.rgba.size();
+			chains.push_back(std::move(chain));
+		}
+
+		for (const bool useRing : { false, true })
+		{
+			std::vector<unsigned int> ids(chains.size());
+			glGenTextures(static_cast<GLsizei>(ids.size()), ids.data());
+			glFinish();
+
+			const auto start = std::chrono::steady_clock::now();
+			for (size_t i = 0; i < chains.size(); i++)
+			{
+				const Chain& chain = chains[i];
+				GLState::Get().BindTexture(ids[i]);
+				if (useRing)
+					TextureUploadRing::Get().UploadLevel(0, GL_RGBA8, chain.width, chain.height, chain.base.data());
+				else
+					glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, chain.width, chain.height, 0, GL_RGBA, GL_UNSIGNED_BYTE, chain.base.data());
+				for (size_t level = 0; level < chain.mips.size(); level++)
+				{
+					const MipLevel& mip = chain.mips[level];
+					if (useRing)
+						TextureUploadRing::Get().UploadLevel(static_cast<GLint>(level + 1), GL_RGBA8, mip.width, mip.height, mip.rgba.data());
+					else
+						glTexImage2D(GL_TEXTURE_2D, static_cast<GLint>(level + 1), GL_RGBA8, mip.width, mip.height, 0, GL_RGBA, GL_UNSIGNED_BYTE,
+							mip.rgba.data());
+				}
+			}
+			const auto issued = std::chrono::steady_clock::now();
+			glFinish();
+			const auto end = std::chrono::steady_clock::now();
+			DeleteTextures(ids);
+
+			std::cout << (useRing ? "PBO ring" : "direct") << ": " << bytes / (1024 * 1024) << " MB, issue "
+				<< std::chrono::duration<double, std::milli>(issued - start).count() << " ms, total "
+				<< std::chrono::duration<double, std::milli>(end - start).count() << " ms" << std::endl;
+		}
+		const TextureUploadStats& stats = TextureUploadRing::Get().GetStats();
+		std::cout << "ring: " << stats.chunks << " slot fills, " << stats.stalls << " stalls (" << stats.stallMs << " ms)" << std::endl;
+		return 0;
+	}
+
+	// Cost of one uniform set the way Shader used to do it, with a name hashed at run time and with a constant handle,
+	// then what drawing the nanosuit costs in uniform work per frame
+	int BenchmarkUniforms()
+	{
+		const int sets = 100000;
+		const Shader shader("Source/Shaders/ModelShaderPacked.vert", "Source/Shaders/ModelShader.frag");
+		shader.Use();
+		const glm::vec3 scale(1.0f);
+		const std::string name = "positionScale";
+		constexpr UniformHandle POSITION_SCALE("positionScale");
+
+		const double lookupMs = TimeMilliseconds([&]
+		{
+			for (int i = 0; i < sets; i++)
+				glUniform3fv(glGetUniformLocation(shader.id, name.c_str()), 1, &scale[0]);
+		});
+		const double hashedMs = TimeMilliseconds([&]
+		{
+			for (int i = 0; i < sets; i++)
+				shader.SetVec3(name, scale);
+		});
+		const double handleMs = TimeMilliseconds([&]
+		{
+			for (int i = 0; i < sets; i++)
+				shader.SetVec3(POSITION_SCALE, scale);
+		});
+		std::cout << "per set: glGetUniformLocation " << lookupMs * 1e6 / sets << " ns, hashed string " << hashedMs * 1e6 / sets
+			<< " ns, constant handle " << handleMs * 1e6 / sets << " ns" << std::endl;
+
+		const float fovY = glm::radians(45.0f);
+		const glm::vec3 eye(0.0f, 0.0f, 3.0f);
+		ModelSettings settings;
+		settings.lodErrors = { 0.002f, 0.01f, 0.04f };
+		Model model(NANOSUIT_PATH, false, settings);
+		ModelLodState state;
+		GetUniformStats() = UniformStats();
+		model.Draw(shader, glm::mat4(1.0f), LodView(eye, fovY, 720.0f), state);
+		const UniformStats stats = GetUniformStats();
+		std::cout << "one nanosuit draw: " << stats.sets << " uniform sets, " << stats.runtimeHashes << " names hashed at run time, "
+			<< stats.driverLookups << " driver lookups (" << stats.sets << " before the location table)" << std::endl;
+		return 0;
+	}
+
+	// CPU cost of binding the nanosuit materials the way Mesh::Draw used to, building sampler names and setting them
+	// on every draw, against the bindings Mesh now resolves once
+	int BenchmarkMaterials()
+	{
+		const int frames = 1000;
+		const Shader shader("Source/Shaders/ModelShader.vert", "Source/Shaders/ModelShader.frag");
+		shader.Use();
+		const Model model(NANOSUIT_PATH);
+		const std::vector<Texture>& textures = model.GetLoadedTextures();
+
+		const double namedMs = TimeMilliseconds([&]
+		{
+			for (int frame = 0; frame < frames; frame++)
+			{
+				unsigned int diffuseNr = 1;
+				unsigned int specularNr = 1;
+				for (unsigned int i = 0; i < textures.size(); i++)
+				{
+					glActiveTexture(GL_TEXTURE0 + i);
+					std::string number;
+					std::string name = textures[i].type;
+					if (name == "texture_diffuse")
+						number = std::to_string(diffuseNr++);
+					else if (name == "texture_specular")
+						number = std::to_string(specularNr++);
+					glUniform1f(glGetUniformLocation(shader.id, ("material." + name += number).c_str()), static_cast<float>(i));
+					glBindTexture(GL_TEXTURE_2D, textures[i].id);
+				}
+			}
+		});
+
+		std::vector<TextureBinding> bindings;
+		for (const Texture& texture : textures)
+			bindings.push_back({ SamplerUnit(texture.type), texture.id });
+		const double resolvedMs = TimeMilliseconds([&]
+		{
+			for (int frame = 0; frame < frames; frame++)
+			{
+				for (const TextureBinding& binding : bindings)
+				{
+					glActiveTexture(GL_TEXTURE0 + binding.unit);
+					glBindTexture(GL_TEXTURE_2D, binding.textureId);
+				}
+			}
+		});
+
+		// the loops above bound textures behind the cache's back
+		GLState& state = GLState::Get();
+		state.Invalidate();
+		const double cachedMs = TimeMilliseconds([&]
+		{
+			for (int frame = 0; frame < frames; frame++)
+			{
+				for (const TextureBinding& binding : bindings)
+					state.BindTexture(binding.unit, binding.textureId);
+			}
+		});
+
+		std::cout << textures.size() << " texture bindings per frame, by name " << namedMs * 1e3 / frames << " us, resolved "
+			<< resolvedMs * 1e3 / frames << " us, through the state cache " << cachedMs * 1e3 / frames << " us" << std::endl;
+		return 0;
+	}
+
+	// Draws nanosuit instances that alternate between two programs, in submission order and through the render queue
+	int BenchmarkRenderQueue()
+	{
+		const int instances = 100;
+		const int frames = 50;
+		const float fovY = glm::radians(45.0f);
+		const glm::vec3 eye(0.0f, 0.0f, 3.0f);
+		const glm::mat4 projection = glm::perspective(fovY, 16.0f / 9.0f, 0.1f, 500.0f);
+		const glm::mat4 view = glm::lookAt(eye, glm::vec3(0.0f, 0.0f, -1.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+		GLState::Get().SetEnabled(GL_DEPTH_TEST, true);
+
+		ModelSettings settings;
+		settings.packGeometry = true;
+		Model model(NANOSUIT_PATH, false, settings);
+		const Shader shaders[2] = {
+			Shader("Source/Shaders/ModelShader.vert", "Source/Shaders/ModelShader.frag"),
+			Shader("Source/Shaders/ModelShader.vert", "Source/Shaders/ModelShader.frag")
+		};
+		CameraUniformBuffer camera;
+		camera.Update(view, projection, eye);
+
+		std::vector<glm::mat4> transforms(instances);
+		for (int i = 0; i < instances; i++)
+		{
+			const glm::vec3 offset((i % 2 ? 1.0f : -1.0f), -1.75f, -2.0f * static_cast<float>(i));
+			transforms[i] = glm::scale(glm::translate(glm::mat4(1.0f), offset), glm::vec3(0.2f));
+		}
+
+		const LodView lodView(eye, fovY, 720.0f);
+		std::vector<ModelLodState> states(instances);
+		const double directMs = TimeMilliseconds([&]
+		{
+			for (int frame = 0; frame < frames; frame++)
+			{
+				glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+				for (int i = 0; i < instances; i++)
+				{
+					shaders[i % 2].Use();
+					model.Draw(shaders[i % 2], transforms[i], lodView, states[i]);
+				}
+			}
+		});
+
+		RenderQueue queue;
+		const double queuedMs = TimeMilliseconds([&]
+		{
+			for (int frame = 0; frame < frames; frame++)
+			{
+				glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+				queue.Begin(eye);
+				for (int i = 0; i < instances; i++)
+					model.Submit(queue, shaders[i % 2], transforms[i], lodView, states[i]);
+				queue.Execute();
+			}
+		});
+
+		const RenderQueueStats& stats = queue.GetStats();
+		std::cout << "submission order: " << directMs / frames << " ms per frame, " << instances << " program binds" << std::endl;
+		std::cout << "render queue: " << queuedMs / frames << " ms per frame, " << stats.draws << " draws, " << stats.programBinds
+			<< " program binds, " << stats.vertexArrayBinds << " VAO binds, " << stats.textureBinds << " texture binds ("
+			<< stats.skippedTextureBinds << " skipped), sort " << stats.sortMs << " ms" << std::endl;
+		return 0;
+	}
+
+	// A grid of nanosuits drawn one model at a time and with one instanced draw per mesh, from 1 up to 100k of them
+	int BenchmarkInstancing()
+	{
+		const int frames = 5;
+		const size_t counts[] = { 1, 10, 100, 1000, 10000, 100000 };
+		const glm::mat4 projection = glm::perspective(glm::radians(45.0f), 16.0f / 9.0f, 0.1f, 500.0f);
+		const glm::vec3 eye(0.0f, 0.0f, 3.0f);
+		const glm::mat4 view = glm::lookAt(eye, glm::vec3(0.0f, 0.0f, -1.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+		GLState::Get().SetEnabled(GL_DEPTH_TEST, true);
+
+		ModelSettings settings;
+		settings.packGeometry = true;
+		Model model(NANOSUIT_PATH, false, settings);
+		const Shader shader("Source/Shaders/ModelShader.vert", "Source/Shaders/ModelShader.frag");
+		const Shader instancedShader("Source/Shaders/ModelShaderInstanced.vert", "Source/Shaders/ModelShader.frag");
+		CameraUniformBuffer camera;
+		camera.Update(view, projection, eye);
+
+		const size_t columns = 100;
+		std::vector<glm::mat4> transforms(counts[sizeof(counts) / sizeof(counts[0]) - 1]);
+		for (size_t i = 0; i < transforms.size(); i++)
+		{
+			const glm::vec3 offset(static_cast<float>(i % columns) * 0.5f - 25.0f, -1.75f, -2.0f - static_cast<float>(i / columns) * 0.5f);
+			transforms[i] = glm::scale(glm::translate(glm::mat4(1.0f), offset), glm::vec3(0.05f));
+		}
+
+		for (const size_t count : counts)
+		{
+			shader.Use();
+			const double separateMs = TimeMilliseconds([&]
+			{
+				for (int frame = 0; frame < frames; frame++)
+				{
+					glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+					for (size_t i = 0; i < count; i++)
+					{
+						FrameDataRing::Get().BindUniformBlock(OBJECT_BLOCK_BINDING, ObjectBlock{ transforms[i] });
+						model.Draw(shader);
+					}
+					FrameDataRing::Get().EndFrame();
+				}
+			});
+
+			// the first call sizes the instance buffer, keep it out of the timing
+			instancedShader.Use();
+			model.DrawInstanced(instancedShader, transforms.data(), count);
+			const double instancedMs = TimeMilliseconds([&]
+			{
+				for (int frame = 0; frame < frames; frame++)
+				{
+					glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+					model.DrawInstanced(instancedShader, transforms.data(), count);
+				}
+			});
+
+			std::cout << count << " models: " << separateMs / frames << " ms per frame drawn one at a time, "
+				<< instancedMs / frames << " ms instanced" << std::endl;
+		}
+		return 0;
+	}
+
+	// A grid of nanosuits through the per-draw render queue and through multi-draw indirect, on a 4.3+ context
+	int BenchmarkMultiDrawIndirect()
+	{
+		if (!IsMultiDrawIndirectSupported())
+		{
+			std::cout << "multi-draw indirect needs GL 4.3, the context is " << GLVersion.major << "." << GLVersion.minor << std::endl;
+			return 1;
+		}
+
+		const int frames = 20;
+		const size_t counts[] = { 100, 1000, 10000 };
+		const float fovY = glm::radians(45.0f);
+		const glm::vec3 eye(0.0f, 0.0f, 3.0f);
+		const glm::mat4 projection = glm::perspective(fovY, 16.0f / 9.0f, 0.1f, 500.0f);
+		const glm::mat4 view = glm::lookAt(eye, glm::vec3(0.0f, 0.0f, -1.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+		GLState::Get().SetEnabled(GL_DEPTH_TEST, true);
+
+		ModelSettings settings;
+		settings.packGeometry = true;
+		settings.lodErrors = { 0.002f, 0.01f, 0.04f };
+		Model model(NANOSUIT_PATH, false, settings);
+		const Shader shader("Source/Shaders/ModelShader.vert", "Source/Shaders/ModelShader.frag");
+		const Shader instancedShader("Source/Shaders/ModelShaderInstanced.vert", "Source/Shaders/ModelShader.frag");
+		CameraUniformBuffer camera;
+		camera.Update(view, projection, eye);
+
+		const size_t columns = 100;
+		std::vector<glm::mat4> transforms(counts[sizeof(counts) / sizeof(counts[0]) - 1]);
+		for (size_t i = 0; i < transforms.size(); i++)
+		{
+			const glm::vec3 offset(static_cast<float>(i % columns) * 0.5f - 25.0f, -1.75f, -2.0f - static_cast<float>(i / columns) * 0.5f);
+			transforms[i] = glm::scale(glm::translate(glm::mat4(1.0f), offset), glm::vec3(0.05f));
+		}
+
+		const LodView lodView(eye, fovY, 720.0f);
+		RenderQueue renderQueue;
+		IndirectDrawQueue indirectQueue;
+		for (const size_t count : counts)
+		{
+			std::vector<ModelLodState> states(count);
+			const double queuedMs = TimeMilliseconds([&]
+			{
+				for (int frame = 0; frame < frames; frame++)
+				{
+					glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+					renderQueue.Begin(eye);
+					for (size_t i = 0; i < count; i++)
+						model.Submit(renderQueue, shader, transforms[i], lodView, states[i]);
+					renderQueue.Execute();
+				}
+			});
+
+			const double indirectMs = TimeMilliseconds([&]
+			{
+				for (int frame = 0; frame < frames; frame++)
+				{
+					glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+					indirectQueue.Begin();
+					for (size_t i = 0; i < count; i++)
+						model.Submit(indirectQueue, transforms[i], lodView, states[i]);
+					indirectQueue.Execute(instancedShader);
+				}
+			});
+
+			const IndirectDrawStats& stats = indirectQueue.GetStats();
+			std::cout << count << " models: render queue " << queuedMs / frames << " ms per frame, " << renderQueue.GetStats().draws
+				<< " draws; multi-draw indirect " << indirectMs / frames << " ms per frame, " << stats.commands << " commands in "
+				<< stats.multiDraws << " calls, build " << stats.buildMs << " ms" << std::endl;
+		}
+		return 0;
+	}
+
+	void PrintStateCounter(const char* name, const GLStateCounter& counter)
+	{
+		std::cout << "  " << name << ": " << counter.issued << " issued, " << counter.elided << " elided" << std::endl;
+	}
+
+	// Nanosuits drawn one mesh at a time through Mesh::Draw, reporting the GL calls the state cache issued and dropped
+	int BenchmarkStateCache()
+	{
+		const int instances = 100;
+		const int frames = 50;
+		const glm::vec3 eye(0.0f, 0.0f, 3.0f);
+		const glm::mat4 projection = glm::perspective(glm::radians(45.0f), 16.0f / 9.0f, 0.1f, 500.0f);
+		const glm::mat4 view = glm::lookAt(eye, glm::vec3(0.0f, 0.0f, -1.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+		GLState& state = GLState::Get();
+		state.SetEnabled(GL_DEPTH_TEST, true);
+
+		Model model(NANOSUIT_PATH);
+		const Shader shader("Source/Shaders/ModelShader.vert", "Source/Shaders/ModelShader.frag");
+		CameraUniformBuffer camera;
+		camera.Update(view, projection, eye);
+
+		state.EndFrame();
+		const double totalMs = TimeMilliseconds([&]
+		{
+			for (int frame = 0; frame < frames; frame++)
+			{
+				glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+				for (int i = 0; i < instances; i++)
+				{
+					const glm::vec3 offset((i % 2 ? 1.0f : -1.0f), -1.75f, -2.0f * static_cast<float>(i));
+					shader.Use();
+					FrameDataRing::Get().BindUniformBlock(OBJECT_BLOCK_BINDING,
+						ObjectBlock{ glm::scale(glm::translate(glm::mat4(1.0f), offset), glm::vec3(0.2f)) });
+					model.Draw(shader);
+				}
+				FrameDataRing::Get().EndFrame();
+				state.EndFrame();
+			}
+		});
+
+		const GLStateStats& stats = state.GetLastFrameStats();
+		const GLStateCounter total = stats.Total();
+		std::cout << totalMs / frames << " ms per frame of " << instances << " models, " << total.issued << " state calls issued and "
+			<< total.elided << " elided per frame" << std::endl;
+		PrintStateCounter("programs", stats.programs);
+		PrintStateCounter("vertex arrays", stats.vertexArrays);
+		PrintStateCounter("active texture", stats.activeTextures);
+		PrintStateCounter("textures", stats.textures);
+		PrintStateCounter("buffers", stats.buffers);
+		PrintStateCounter("enable/disable", stats.capabilities);
+		return 0;
+	}
+
+	// Thousands of small objects per frame whose transforms change every frame, set as a uniform per draw and written
+	// through the frame data ring
+	int BenchmarkFrameData()
+	{
+		const int frames = 20;
+		const size_t counts[] = { 1000, 10000, 50000 };
+		const glm::vec3 eye(0.0f, 0.0f, 3.0f);
+		const glm::mat4 projection = glm::perspective(glm::radians(45.0f), 16.0f / 9.0f, 0.1f, 500.0f);
+		const glm::mat4 view = glm::lookAt(eye, glm::vec3(0.0f, 0.0f, -1.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+		CameraUniformBuffer camera;
+		camera.Update(view, projection, eye);
+
+		std::vector<Vertex> vertices(3);
+		vertices[1].position = glm::vec3(0.05f, 0.0f, 0.0f);
+		vertices[2].position = glm::vec3(0.0f, 0.05f, 0.0f);
+		Mesh triangle(vertices, { 0, 1, 2 }, std::vector<Texture>());
+		// vertexShader.vert still takes its model matrix as a plain uniform
+		const Shader uniformShader("Source/Shaders/vertexShader.vert", "Source/Shaders/fragmentShader.frag");
+		const Shader blockShader("Source/Shaders/ModelShader.vert", "Source/Shaders/ModelShader.frag");
+		static constexpr UniformHandle MODEL_UNIFORM("model");
+
+		FrameDataRing& ring = FrameDataRing::Get();
+		for (const size_t count : counts)
+		{
+			const auto transform = [count](const size_t i, const int frame)
+			{
+				const float angle = static_cast<float>(i) / static_cast<float>(count) * 6.2832f + static_cast<float>(frame) * 0.01f;
+				return glm::translate(glm::mat4(1.0f), glm::vec3(std::cos(angle) * 2.0f, std::sin(angle) * 1.0f, -2.0f));
+			};
+
+			uniformShader.Use();
+			const double uniformMs = TimeMilliseconds([&]
+			{
+				for (int frame = 0; frame < frames; frame++)
+				{
+					glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+					for (size_t i = 0; i < count; i++)
+					{
+						uniformShader.SetMat4(MODEL_UNIFORM, transform(i, frame));
+						triangle.Draw(uniformShader);
+					}
+				}
+			});
+
+			blockShader.Use();
+			size_t maxFrameBytes = 0;
+			const FrameDataStats before = ring.GetStats();
+			const double ringMs = TimeMilliseconds([&]
+			{
+				for (int frame = 0; frame < frames; frame++)
+				{
+					glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+					for (size_t i = 0; i < count; i++)
+					{
+						ring.BindUniformBlock(OBJECT_BLOCK_BINDING, ObjectBlock{ transform(i, frame) });
+						triangle.Draw(blockShader);
+					}
+					maxFrameBytes = std::max(maxFrameBytes, ring.GetStats().frameBytes);
+					ring.EndFrame();
+				}
+			});
+
+			const FrameDataStats& stats = ring.GetStats();
+			std::cout << count << " objects: uniforms " << uniformMs / frames << " ms per frame, " << (stats.persistent ? "persistent" : "orphaned")
+				<< " ring " << ringMs / frames << " ms per frame, " << maxFrameBytes / 1024 << " KB per frame, "
+				<< stats.stalls - before.stalls << " stalls (" << stats.stallMs - before.stallMs << " ms)" << std::endl;
+		}
+		return 0;
+	}
+
+	// The culling pass on its own against a plane by plane loop over the same bounds, then a field of models around
+	// the camera drawn with and without culling
+	int BenchmarkCulling()
+	{
+		const int passes = 100;
+		const size_t boundsCount = 100000;
+		const float fovY = glm::radians(45.0f);
+		const glm::vec3 eye(0.0f, 0.0f, 3.0f);
+		const glm::mat4 projection = glm::perspective(fovY, 16.0f / 9.0f, 0.1f, 500.0f);
+		const glm::mat4 view = glm::lookAt(eye, glm::vec3(0.0f, 0.0f, -1.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+		const Frustum frustum = ExtractFrustum(projection * view);
+
+		// spread around the camera in every direction, so most of them are behind or beside it
+		std::srand(1);
+		const auto random = [] { return static_cast<float>(std::rand()) / static_cast<float>(RAND_MAX); };
+		std::vector<CullBounds> bounds(boundsCount);
+		for (CullBounds& b : bounds)
+		{
+			b.center = eye + glm::vec3(random() - 0.5f, random() - 0.5f, random() - 0.5f) * 400.0f;
+			b.extents = glm::vec3(random(), random(), random()) * 2.0f;
+			b.radius = glm::length(b.extents);
+			b.padding = 0.0f;
+		}
+
+		std::vector<unsigned char> visible(boundsCount), reference(boundsCount);
+		size_t visibleCount = 0;
+		const double simdMs = TimeMilliseconds([&]
+		{
+			for (int pass = 0; pass < passes; pass++)
+				visibleCount = FrustumCuller::Get().Cull(frustum, bounds.data(), bounds.size(), visible.data());
+		});
+		const double scalarMs = TimeMilliseconds([&]
+		{
+			for (int pass = 0; pass < passes; pass++)
+			{
+				for (size_t i = 0; i < boundsCount; i++)
+				{
+					bool inside = true;
+					for (const glm::vec4& plane : frustum.planes)
+					{
+						const float box = glm::dot(glm::abs(glm::vec3(plane)), bounds[i].extents);
+						if (glm::dot(glm::vec3(plane), bounds[i].center) + plane.w + std::min(box, bounds[i].radius) < 0.0f)
+						{
+							inside = false;
+							break;
+						}
+					}
+					reference[i] = inside;
+				}
+			}
+		});
+		if (visible != reference)
+		{
+			std::cout << "ERROR::BENCHMARK::CULLING_MISMATCH" << std::endl;
+			return 1;
+		}
+		std::cout << boundsCount << " bounds, " << visibleCount << " visible: culling pass " << simdMs / passes << " ms, one at a time "
+			<< scalarMs / passes << " ms" << std::endl;
+
+		const int frames = 20;
+		const int rings = 8;
+		const int perRing = 16;
+		GLState::Get().SetEnabled(GL_DEPTH_TEST, true);
+		Model model(NANOSUIT_PATH);
+		const Shader shader("Source/Shaders/ModelShader.vert", "Source/Shaders/ModelShader.frag");
+		CameraUniformBuffer camera;
+		camera.Update(view, projection, eye);
+		shader.Use();
+
+		std::vector<glm::mat4> transforms;
+		for (int ring = 0; ring < rings; ring++)
+		{
+			for (int i = 0; i < perRing; i++)
+			{
+				const float angle = static_cast<float>(i) / perRing * 6.2832f;
+				const float distance = 4.0f + 3.0f * static_cast<float>(ring);
+				const glm::vec3 offset(eye.x + std::cos(angle) * distance, -1.75f, eye.z + std::sin(angle) * distance);
+				transforms.push_back(glm::scale(glm::translate(glm::mat4(1.0f), offset), glm::vec3(0.2f)));
+			}
+		}
+
+		LodView lodView(eye, fovY, 720.0f);
+		std::vector<ModelLodState> states(transforms.size());
+		const auto drawFrames = [&]
+		{
+			size_t triangles = 0;
+			for (int frame = 0; frame < frames; frame++)
+			{
+				glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+				triangles = 0;
+				for (size_t i = 0; i < transforms.size(); i++)
+					triangles += model.Draw(shader, transforms[i], lodView, states[i]);
+				FrameDataRing::Get().EndFrame();
+				FrustumCuller::Get().EndFrame();
+			}
+			glFinish();
+			return triangles;
+		};
+
+		size_t allTriangles = 0, culledTriangles = 0;
+		const double allMs = TimeMilliseconds([&] { allTriangles = drawFrames(); });
+		lodView.frustum = &frustum;
+		const double culledMs = TimeMilliseconds([&] { culledTriangles = drawFrames(); });
+
+		const CullingStats& stats = FrustumCuller::Get().GetLastFrameStats();
+		std::cout << transforms.size() << " models: everything " << allTriangles << " triangles " << allMs / frames << " ms per frame, culled "
+			<< culledTriangles << " triangles " << culledMs / frames << " ms per frame (" << stats.visible << " meshes visible, " << stats.culled
+			<< " culled, " << stats.cullMs << " ms culling)" << std::endl;
+		return 0;
+	}
+
+	// A synthetic scene of 100k nodes in scattered groups: building the hierarchy, refitting it after a group moved, and
+	// culling through it against testing the bounds of every mesh
+	int BenchmarkSceneGraph()
+	{
+		const int passes = 20;
+		const int groups = 400;
+		const int nodesPerGroup = 250;
+
+		// a root, the groups below it and a node with one mesh for every member
+		std::srand(1);
+		const auto random = [] { return static_cast<float>(std::rand()) / static_cast<float>(RAND_MAX); };
+		std::vector<SceneNode> nodes;
+		nodes.push_back(SceneNode{ glm::mat4(1.0f), -1, 0, 0 });
+		uint32_t meshCount = 0;
+		for (int group = 0; group < groups; group++)
+		{
+			const auto groupIndex = static_cast<int32_t>(nodes.size());
+			const glm::vec3 groupOffset((random() - 0.5f) * 600.0f, (random() - 0.5f) * 60.0f, (random() - 0.5f) * 600.0f);
+			nodes.push_back(SceneNode{ glm::translate(glm::mat4(1.0f), groupOffset), 0, meshCount, 0 });
+			for (int member = 0; member < nodesPerGroup; member++)
+			{
+				const glm::vec3 offset((random() - 0.5f) * 20.0f, (random() - 0.5f) * 20.0f, (random() - 0.5f) * 20.0f);
+				const glm::mat4 transform = glm::scale(glm::translate(glm::mat4(1.0f), offset), glm::vec3(0.5f + random()));
+				nodes.push_back(SceneNode{ transform, groupIndex, meshCount, 1 });
+				meshCount++;
+			}
+		}
+		const std::vector<CullBounds> meshBounds(meshCount, CullBounds{ glm::vec3(0.0f), std::sqrt(3.0f), glm::vec3(1.0f), 0.0f });
+
+		SceneGraph scene;
+		const double buildMs = TimeMilliseconds([&]
+		{
+			scene.SetNodes(nodes, meshCount);
+			scene.Build(meshBounds.data(), meshBounds.size());
+		});
+		const double updateMs = TimeMilliseconds([&]
+		{
+			for (int pass = 0; pass < passes; pass++)
+			{
+				scene.SetLocalTransform(1, glm::translate(nodes[1].transform, glm::vec3(static_cast<float>(pass), 0.0f, 0.0f)));
+				scene.Update();
+			}
+		});
+
+		const glm::mat4 projection = glm::perspective(glm::radians(45.0f), 16.0f / 9.0f, 0.1f, 500.0f);
+		const glm::mat4 view = glm::lookAt(glm::vec3(0.0f), glm::vec3(0.0f, 0.0f, -1.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+		const Frustum frustum = ExtractFrustum(projection * view);
+		std::vector<unsigned char> hierarchyVisible(meshCount), flatVisible(meshCount);
+		FrustumCuller& culler = FrustumCuller::Get();
+		culler.EndFrame();
+
+		size_t visibleCount = 0;
+		const double hierarchyMs = TimeMilliseconds([&]
+		{
+			for (int pass = 0; pass < passes; pass++)
+				visibleCount = scene.Cull(frustum, hierarchyVisible.data());
+		});
+		const size_t hierarchyTested = culler.GetFrameStats().tested / passes;
+		culler.EndFrame();
+		const double flatMs = TimeMilliseconds([&]
+		{
+			for (int pass = 0; pass < passes; pass++)
+				culler.Cull(frustum, scene.GetMeshBounds().data(), meshCount, flatVisible.data());
+		});
+		culler.EndFrame();
+		if (hierarchyVisible != flatVisible)
+		{
+			std::cout << "ERROR::BENCHMARK::SCENE_GRAPH_MISMATCH" << std::endl;
+			return 1;
+		}
+
+		std::cout << nodes.size() << " nodes, " << meshCount << " meshes: build " << buildMs
+			<< " ms, move a group " << updateMs / passes << " ms" << std::endl;
+		std::cout << visibleCount << " visible: hierarchy " << hierarchyMs / passes << " ms with " << hierarchyTested << " tests, every mesh "
+			<< flatMs / passes << " ms with " << meshCount << " tests" << std::endl;
+		return 0;
+	}
+
+	struct BenchmarkEntry
+	{
+		const char* name;
+		int (*run)();
+	};
+
+	const BenchmarkEntry BENCHMARKS[] = {
+		{ "--bench-load", BenchmarkModelLoad },
+		{ "--bench-textures", BenchmarkTextureDecode },
+		{ "--bench-import", BenchmarkMeshImport },
+		{ "--bench-optimize", BenchmarkMeshOptimize },
+		{ "--bench-vertex-formats", BenchmarkVertexFormats },
+		{ "--bench-shared-geometry", BenchmarkSharedGeometry },
+		{ "--bench-async-load", BenchmarkAsyncLoad },
+		{ "--bench-lod", BenchmarkLod },
+		{ "--cook-textures", CookTextures },
+		{ "--bench-compressed-textures", BenchmarkCompressedTextures },
+		{ "--bench-mips", BenchmarkMipGeneration },
+		{ "--bench-image-decode", BenchmarkImageDecode },
+		{ "--bench-streaming", BenchmarkTextureStreaming },
+		{ "--bench-upload", BenchmarkTextureUpload },
+		{ "--bench-uniforms", BenchmarkUniforms },
+		{ "--bench-materials", BenchmarkMaterials },
+		{ "--bench-render-queue", BenchmarkRenderQueue },
+		{ "--bench-instancing", BenchmarkInstancing },
+		{ "--bench-multi-draw", BenchmarkMultiDrawIndirect },
+		{ "--bench-state-cache", BenchmarkStateCache },
+		{ "--bench-frame-data", BenchmarkFrameData },
+		{ "--bench-culling", BenchmarkCulling },
+		{ "--bench-scene-graph", BenchmarkSceneGraph },
+	};
+}
+
+int RunBenchmark(const std::string& name)
+{
+	for (const BenchmarkEntry& benchmark : BENCHMARKS)
+	{
+		if (name == benchmark.name)
+			return benchmark.run();
+	}
+
+	std::cout << "Unknown benchmark " << name << ", available:";
+	for (const BenchmarkEntry& benchmark : BENCHMARKS)
+		std::cout << ' ' << benchmark.name;
+	std::cout << std::endl;
+	return 1;
+}
@@ -0,0 +1,6 @@
+#pragma once
+#include <string>
+
+// Headless measurements selected from the command line, e.g. "LearnOpenGL.exe --bench-load".
+// Expects a current GL context and returns the process exit code.
+int RunBenchmark(const std::string& name);
@@ -0,0 +1,131 @@
+#include "BoundingVolumeHierarchy.h"
+
+#include <algorithm>
+
+void BoundingVolumeHierarchy::Build(const CullBounds* bounds, const size_t count)
+{
+	nodes.clear();
+	items.resize(count);
+	for (size_t i = 0; i < count; i++)
+		items[i] = static_cast<uint32_t>(i);
+	if (count == 0)
+		return;
+
+	// a median split halves the items, so there are fewer than two nodes per leaf item
+	nodes.reserve(2 * (count + LEAF_ITEMS - 1) / LEAF_ITEMS);
+	BuildNode(bounds, 0, static_cast<uint32_t>(count));
+}
+
+void BoundingVolumeHierarchy::BuildNode(const CullBounds* bounds, const uint32_t firstItem, const uint32_t itemCount)
+{
+	const auto index = static_cast<uint32_t>(nodes.size());
+	nodes.emplace_back();
+	BvhNode& node = nodes.back();
+	node.firstItem = firstItem;
+	node.itemCount = itemCount;
+	FitLeaf(node, bounds);
+	if (itemCount <= LEAF_ITEMS)
+	{
+		node.skip = index + 1;
+		return;
+	}
+
+	glm::vec3 centerMin = bounds[items[firstItem]].center, centerMax = centerMin;
+	for (uint32_t i = firstItem; i < firstItem + itemCount; i++)
+	{
+		centerMin = glm::min(centerMin, bounds[items[i]].center);
+		centerMax = glm::max(centerMax, bounds[items[i]].center);
+	}
+	const glm::vec3 spread = centerMax - centerMin;
+	const int axis = spread.x >= spread.y && spread.x >= spread.z ? 0 : spread.y >= spread.z ? 1 : 2;
+
+	const uint32_t half = itemCount / 2;
+	uint32_t* first = items.data() + firstItem;
+	std::nth_element(first, first + half, first + itemCount, [bounds, axis](const uint32_t a, const uint32_t b)
+	{
+		return bounds[a].center[axis] < bounds[b].center[axis];
+	});
+
+	BuildNode(bounds, firstItem, half);
+	BuildNode(bounds, firstItem + half, itemCount - half);
+	// node may have moved while the children were added
+	nodes[index].skip = static_cast<uint32_t>(nodes.size());
+}
+
+void BoundingVolumeHierarchy::FitLeaf(BvhNode& node, const CullBounds* bounds) const
+{
+	const CullBounds& first = bounds[items[node.firstItem]];
+	node.boundsMin = first.center - first.extents;
+	node.boundsMax = first.center + first.extents;
+	for (uint32_t i = node.firstItem + 1; i < node.firstItem + node.itemCount; i++)
+	{
+		const CullBounds& item = bounds[items[i]];
+		node.boundsMin = glm::min(node.boundsMin, item.center - item.extents);
+		node.boundsMax = glm::max(node.boundsMax, item.center + item.extents);
+	}
+}
+
+void BoundingVolumeHierarchy::Refit(const CullBounds* bounds)
+{
+	// children always follow their parent, so walking backwards sees them first
+	for (size_t i = nodes.size(); i-- > 0;)
+	{
+		BvhNode& node = nodes[i];
+		if (node.skip == i + 1)
+		{
+			FitLeaf(node, bounds);
+			continue;
+		}
+		const BvhNode& left = nodes[i + 1];
+		const BvhNode& right = nodes[left.skip];
+		node.boundsMin = glm::min(left.boundsMin, right.boundsMin);
+		node.boundsMax = glm::max(left.boundsMax, right.boundsMax);
+	}
+}
+
+size_t BoundingVolumeHierarchy::Traverse(const Frustum& frustum, unsigned char* visible, std::vector<uint32_t>& candidates) const
+{
+	size_t tested = 0;
+	size_t i = 0;
+	while (i < nodes.size())
+	{
+		const BvhNode& node = nodes[i];
+		tested++;
+		const glm::vec3 center = (node.boundsMin + node.boundsMax) * 0.5f;
+		const glm::vec3 extents = (node.boundsMax - node.boundsMin) * 0.5f;
+		bool outside = false, inside = true;
+		for (const glm::vec4& plane : frustum.planes)
+		{
+			const float distance = glm::dot(glm::vec3(plane), center) + plane.w;
+			const float reach = glm::dot(glm::abs(glm::vec3(plane)), extents);
+			if (distance + reach < 0.0f)
+			{
+				outside = true;
+				break;
+			}
+			inside = inside && distance - reach >= 0.0f;
+		}
+
+		const bool leaf = node.skip == i + 1;
+		if (outside)
+		{
+			i = node.skip;
+		}
+		else if (inside)
+		{
+			for (uint32_t item = node.firstItem; item < node.firstItem + node.itemCount; item++)
+				visible[items[item]] = 1;
+			i = node.skip;
+		}
+		else if (leaf)
+		{
+			candidates.insert(candidates.end(), items.begin() + node.firstItem, items.begin() + node.firstItem + node.itemCount);
+			i = node.skip;
+		}
+		else
+		{
+			i++;
+		}
+	}
+	return tested;
+}
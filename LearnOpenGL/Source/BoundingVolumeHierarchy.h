@@ -0,0 +1,46 @@
+#pragma once
+#include "Frustum.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <glm/glm.hpp>
+#include <vector>
+
+struct BvhNode
+{
+	glm::vec3 boundsMin;
+	uint32_t firstItem; // the subtree holds GetItems()[firstItem, firstItem + itemCount)
+	glm::vec3 boundsMax;
+	uint32_t itemCount;
+	uint32_t skip;      // first node after the subtree, the node is a leaf when that is the next one
+};
+
+// Bounding volume hierarchy over boxes, flattened in depth first order so every subtree is a contiguous run of nodes
+// and of items. Traversal walks the array front to back and jumps over the subtrees it is done with, so it needs no
+// stack and touches memory in order however large the scene gets.
+class BoundingVolumeHierarchy
+{
+public:
+	static const size_t LEAF_ITEMS = 4;
+
+	// Splits at the median of the longest axis of the box centers until no leaf holds more than LEAF_ITEMS
+	void Build(const CullBounds* bounds, size_t count);
+	// Recomputes the node boxes after items moved, keeping the tree. Cheaper than Build but the boxes grow looser the
+	// further items move from where they were built.
+	void Refit(const CullBounds* bounds);
+
+	// Sets visible[item] for every item whose subtree is entirely inside the frustum and appends the items of leaves
+	// that straddle it to candidates, returns the number of nodes tested. Items of rejected subtrees are left alone.
+	size_t Traverse(const Frustum& frustum, unsigned char* visible, std::vector<uint32_t>& candidates) const;
+
+	bool IsEmpty() const { return nodes.empty(); }
+	const std::vector<BvhNode>& GetNodes() const { return nodes; }
+	const std::vector<uint32_t>& GetItems() const { return items; }
+
+private:
+	std::vector<BvhNode> nodes;
+	std::vector<uint32_t> items; // item indices in node order
+
+	void BuildNode(const CullBounds* bounds, uint32_t firstItem, uint32_t itemCount);
+	void FitLeaf(BvhNode& node, const CullBounds* bounds) const;
+};
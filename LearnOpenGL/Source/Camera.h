@@ -5,6 +5,8 @@
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 
+#include "Frustum.h"
+
 #include <vector>
 
 enum CameraMovement {
@@ -65,6 +67,12 @@ public:
 		return glm::lookAt(Position, Position + Front, Up);
 	}
 
+	// Returns the world space frustum seen through the given projection from the current view
+	Frustum GetFrustum(const glm::mat4& projection) const
+	{
+		return ExtractFrustum(projection * GetViewMatrix());
+	}
+
 	// Processes input received from any keyboard-like input system. Accepts input parameter in the form of camera defined ENUM (to abstract it from windowing systems)
 	void ProcessKeyboard(const CameraMovement direction, const float deltaTime)
 	{
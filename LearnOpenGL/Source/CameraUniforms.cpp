@@ -0,0 +1,33 @@
+#include "CameraUniforms.h"
+#include "GLState.h"
+
+static_assert(sizeof(CameraBlock) == 208, "CameraBlock has to match the std140 layout of the Camera block");
+
+CameraUniformBuffer::~CameraUniformBuffer()
+{
+	Release();
+}
+
+void CameraUniformBuffer::Update(const glm::mat4& view, const glm::mat4& projection, const glm::vec3& viewPos)
+{
+	CameraBlock block;
+	block.view = view;
+	block.projection = projection;
+	block.viewProjection = projection * view;
+	block.viewPos = viewPos;
+	block.padding = 0.0f;
+
+	if (!buffer)
+		glGenBuffers(1, &buffer);
+	// respecifying the whole block hands the driver fresh storage while last frame's draws may still read the old one
+	GLState::Get().BindBuffer(GL_UNIFORM_BUFFER, buffer);
+	glBufferData(GL_UNIFORM_BUFFER, sizeof(block), &block, GL_STREAM_DRAW);
+	GLState::Get().BindBufferBase(GL_UNIFORM_BUFFER, CAMERA_BLOCK_BINDING, buffer);
+}
+
+void CameraUniformBuffer::Release()
+{
+	if (buffer)
+		GLState::Get().DeleteBuffer(buffer);
+	buffer = 0;
+}
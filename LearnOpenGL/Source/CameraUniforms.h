@@ -0,0 +1,34 @@
+#pragma once
+#include "Shader.h"
+
+#include <glm/glm.hpp>
+
+// The Camera uniform block of the shaders in std140 layout
+struct CameraBlock
+{
+	glm::mat4 view;
+	glm::mat4 projection;
+	glm::mat4 viewProjection;
+	glm::vec3 viewPos;
+	float padding; // std140 rounds the vec3 up to 16 bytes
+};
+
+// Buffer behind the Camera block that every shipped shader reads its view and projection from. It is written once per
+// frame and stays bound at CAMERA_BLOCK_BINDING, so adding programs adds no per frame uniform uploads.
+class CameraUniformBuffer
+{
+public:
+	CameraUniformBuffer() = default;
+	~CameraUniformBuffer();
+
+	CameraUniformBuffer(const CameraUniformBuffer&) = delete;
+	CameraUniformBuffer& operator=(const CameraUniformBuffer&) = delete;
+
+	void Update(const glm::mat4& view, const glm::mat4& projection, const glm::vec3& viewPos);
+
+	// Deletes the buffer, for instances that outlive the context. The next Update recreates it.
+	void Release();
+
+private:
+	unsigned int buffer = 0;
+};
@@ -0,0 +1,136 @@
+#include "FrameDataRing.h"
+#include "GLExtensions.h"
+#include "GLState.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+
+FrameDataRing& FrameDataRing::Get()
+{
+	static FrameDataRing ring;
+	return ring;
+}
+
+void FrameDataRing::BindUniformBlock(const GLuint binding, const void* data, const size_t bytes)
+{
+	if (!buffer)
+		Create();
+	if (bytes > REGION_BYTES)
+	{
+		std::cout << "ERROR::FRAMEDATARING::BLOCK LARGER THAN A REGION" << std::endl;
+		return;
+	}
+
+	offset = (offset + alignment - 1) / alignment * alignment;
+	if (offset + bytes > REGION_BYTES)
+		NextRegion();
+
+	GLState& state = GLState::Get();
+	const size_t bufferOffset = mapped ? region * REGION_BYTES + offset : offset;
+	if (mapped)
+	{
+		// coherent, so the copy is visible to every command issued after it
+		std::memcpy(mapped + bufferOffset, data, bytes);
+	}
+	else
+	{
+		state.BindBuffer(GL_UNIFORM_BUFFER, buffer);
+		glBufferSubData(GL_UNIFORM_BUFFER, static_cast<GLintptr>(bufferOffset), static_cast<GLsizeiptr>(bytes), data);
+	}
+	state.BindBufferRange(GL_UNIFORM_BUFFER, binding, buffer, static_cast<GLintptr>(bufferOffset), static_cast<GLsizeiptr>(bytes));
+
+	offset += bytes;
+	stats.writes++;
+	stats.frameBytes += bytes;
+}
+
+void FrameDataRing::EndFrame()
+{
+	stats.maxFrameBytes = std::max(stats.maxFrameBytes, stats.frameBytes);
+	stats.frameBytes = 0;
+	stats.writes = 0;
+	if (buffer && offset > 0)
+		NextRegion();
+}
+
+void FrameDataRing::Release()
+{
+	for (GLsync& fence : fences)
+	{
+		if (fence)
+			glDeleteSync(fence);
+		fence = nullptr;
+	}
+	if (buffer)
+	{
+		if (mapped)
+		{
+			GLState::Get().BindBuffer(GL_UNIFORM_BUFFER, buffer);
+			glUnmapBuffer(GL_UNIFORM_BUFFER);
+		}
+		GLState::Get().DeleteBuffer(buffer);
+	}
+	buffer = 0;
+	mapped = nullptr;
+	region = offset = 0;
+}
+
+void FrameDataRing::Create()
+{
+	GLint uniformAlignment = 0;
+	glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &uniformAlignment);
+	alignment = std::max<size_t>(static_cast<size_t>(uniformAlignment), 16);
+
+	glGenBuffers(1, &buffer);
+	GLState::Get().BindBuffer(GL_UNIFORM_BUFFER, buffer);
+	if (GLExt::BufferStorage)
+	{
+		const GLbitfield flags = GL_MAP_WRITE_BIT | GLExt::MAP_PERSISTENT_BIT | GLExt::MAP_COHERENT_BIT;
+		GLExt::BufferStorage(GL_UNIFORM_BUFFER, REGION_COUNT * REGION_BYTES, nullptr, flags);
+		mapped = static_cast<unsigned char*>(glMapBufferRange(GL_UNIFORM_BUFFER, 0, REGION_COUNT * REGION_BYTES, flags));
+		if (!mapped)
+		{
+			// immutable storage can't be respecified, so start over with a plain buffer
+			GLState::Get().DeleteBuffer(buffer);
+			glGenBuffers(1, &buffer);
+			GLState::Get().BindBuffer(GL_UNIFORM_BUFFER, buffer);
+		}
+	}
+	if (!mapped)
+		glBufferData(GL_UNIFORM_BUFFER, REGION_BYTES, nullptr, GL_STREAM_DRAW);
+
+	stats.persistent = mapped != nullptr;
+	region = offset = 0;
+}
+
+void FrameDataRing::NextRegion()
+{
+	offset = 0;
+	if (!mapped)
+	{
+		// draws already issued keep the old storage, new writes get a fresh one without waiting for them
+		GLState::Get().BindBuffer(GL_UNIFORM_BUFFER, buffer);
+		glBufferData(GL_UNIFORM_BUFFER, REGION_BYTES, nullptr, GL_STREAM_DRAW);
+		return;
+	}
+
+	fences[region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	region = (region + 1) % REGION_COUNT;
+	GLsync& fence = fences[region];
+	if (!fence)
+		return;
+
+	if (glClientWaitSync(fence, 0, 0) == GL_TIMEOUT_EXPIRED)
+	{
+		const auto start = std::chrono::steady_clock::now();
+		while (glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000) == GL_TIMEOUT_EXPIRED)
+		{
+		}
+		stats.stalls++;
+		stats.stallMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	}
+	glDeleteSync(fence);
+	fence = nullptr;
+}
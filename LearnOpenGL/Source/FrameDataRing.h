@@ -0,0 +1,67 @@
+#pragma once
+#include <cstddef>
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+// The Object uniform block of the model shaders in std140 layout
+struct ObjectBlock
+{
+	glm::mat4 model;
+};
+
+struct FrameDataStats
+{
+	bool persistent = false;  // the buffer is persistently mapped, otherwise it is orphaned
+	size_t writes = 0;        // blocks written since the last EndFrame
+	size_t frameBytes = 0;    // bytes written since the last EndFrame
+	size_t maxFrameBytes = 0; // most written in one frame
+	size_t stalls = 0;        // times the next region was still in use by the GPU
+	double stallMs = 0.0;
+};
+
+// Ring buffer for data that changes every frame, like per draw constants. Blocks are written one after the other and
+// bound by offset with glBindBufferRange, so thousands of objects cost a copy and a bind each instead of a uniform
+// update per value. On GL 4.4 the buffer is mapped persistently once and split into REGION_COUNT regions, one per
+// frame in flight, each guarded by a fence so it is only rewritten once the GPU is done with it. On 3.3 the buffer is
+// orphaned at the start of every frame instead and the blocks go in with glBufferSubData.
+// Like the rest of the GL resources it may only be used from the thread that owns the context.
+class FrameDataRing
+{
+public:
+	static FrameDataRing& Get();
+
+	static const size_t REGION_COUNT = 3;
+	static const size_t REGION_BYTES = 4 * 1024 * 1024;
+
+	// Copies the block into the ring and binds it to a uniform block binding point for the following draws
+	void BindUniformBlock(GLuint binding, const void* data, size_t bytes);
+	template <typename Block>
+	void BindUniformBlock(const GLuint binding, const Block& block)
+	{
+		BindUniformBlock(binding, &block, sizeof(Block));
+	}
+
+	// Call once per frame after the last draw that reads from the ring
+	void EndFrame();
+
+	const FrameDataStats& GetStats() const { return stats; }
+
+	// Deletes the buffer and fences, call before the context goes away. The ring recreates them on the next write.
+	void Release();
+
+private:
+	unsigned int buffer = 0;
+	unsigned char* mapped = nullptr; // the whole buffer while it is persistently mapped
+	size_t alignment = 256;          // GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT
+	GLsync fences[REGION_COUNT] = {};
+	size_t region = 0;
+	size_t offset = 0;               // next free byte in the current region
+	FrameDataStats stats;
+
+	FrameDataRing() = default;
+
+	void Create();
+	// Fences the current region and moves on to the next, waiting for the GPU if it still reads from it.
+	// Without the persistent mapping the buffer is orphaned instead.
+	void NextRegion();
+};
@@ -0,0 +1,183 @@
+#include "Frustum.h"
+#include "BoundingVolumeHierarchy.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+#if defined(_M_X64) || defined(__SSE2__)
+#include <emmintrin.h>
+#define FRUSTUM_CULLER_SSE2
+#endif
+
+Frustum ExtractFrustum(const glm::mat4& viewProjection)
+{
+	// a clip space point is inside when -w <= x, y, z <= w, each side is the w row plus or minus one of the others
+	const auto row = [&viewProjection](const int i)
+	{
+		return glm::vec4(viewProjection[0][i], viewProjection[1][i], viewProjection[2][i], viewProjection[3][i]);
+	};
+	Frustum frustum;
+	for (int axis = 0; axis < 3; axis++)
+	{
+		frustum.planes[axis * 2] = row(3) + row(axis);
+		frustum.planes[axis * 2 + 1] = row(3) - row(axis);
+	}
+	for (glm::vec4& plane : frustum.planes)
+		plane /= glm::length(glm::vec3(plane));
+	return frustum;
+}
+
+Frustum TransformFrustum(const Frustum& frustum, const glm::mat4& transform)
+{
+	// a point p in the new space is at transform * p, so dot(plane, transform * p) = dot(transpose(transform) * plane, p).
+	// Scaling a plane doesn't change the sign of the box test, and after normalizing the sphere test is exact as well.
+	const glm::mat4 transposed = glm::transpose(transform);
+	Frustum result;
+	for (int i = 0; i < 6; i++)
+	{
+		result.planes[i] = transposed * frustum.planes[i];
+		result.planes[i] /= glm::length(glm::vec3(result.planes[i]));
+	}
+	return result;
+}
+
+CullBounds TransformBounds(const CullBounds& bounds, const glm::mat4& transform)
+{
+	// the box of the transformed box is spanned by the absolute values of the matrix
+	const glm::mat3 linear(transform);
+	const glm::mat3 absolute(glm::abs(linear[0]), glm::abs(linear[1]), glm::abs(linear[2]));
+	const float scale = std::max({ glm::length(linear[0]), glm::length(linear[1]), glm::length(linear[2]) });
+	return CullBounds{ glm::vec3(transform * glm::vec4(bounds.center, 1.0f)), bounds.radius * scale, absolute * bounds.extents, 0.0f };
+}
+
+namespace
+{
+	// how far the box reaches towards the plane, never more than the sphere does
+	inline float Reach(const glm::vec4& plane, const CullBounds& bounds)
+	{
+		const float box = std::abs(plane.x) * bounds.extents.x + std::abs(plane.y) * bounds.extents.y + std::abs(plane.z) * bounds.extents.z;
+		return std::min(box, bounds.radius);
+	}
+}
+
+FrustumCuller& FrustumCuller::Get()
+{
+	static FrustumCuller culler;
+	return culler;
+}
+
+size_t FrustumCuller::Cull(const Frustum& frustum, const glm::mat4& transform, const CullBounds* bounds, const size_t count, unsigned char* visible)
+{
+	const auto start = std::chrono::steady_clock::now();
+
+	worldBounds.resize(count);
+	for (size_t i = 0; i < count; i++)
+		worldBounds[i] = TransformBounds(bounds[i], transform);
+	const size_t visibleCount = Test(frustum, worldBounds.data(), count, visible);
+
+	frameStats.tested += count;
+	frameStats.visible += visibleCount;
+	frameStats.culled += count - visibleCount;
+	frameStats.cullMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	return visibleCount;
+}
+
+size_t FrustumCuller::Cull(const Frustum& frustum, const CullBounds* bounds, const size_t count, unsigned char* visible)
+{
+	const auto start = std::chrono::steady_clock::now();
+	const size_t visibleCount = Test(frustum, bounds, count, visible);
+
+	frameStats.tested += count;
+	frameStats.visible += visibleCount;
+	frameStats.culled += count - visibleCount;
+	frameStats.cullMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	return visibleCount;
+}
+
+size_t FrustumCuller::Cull(const Frustum& frustum, const BoundingVolumeHierarchy& hierarchy, const CullBounds* bounds, const size_t count,
+	unsigned char* visible)
+{
+	const auto start = std::chrono::steady_clock::now();
+	std::fill(visible, visible + count, 0);
+	candidates.clear();
+	const size_t nodesTested = hierarchy.Traverse(frustum, visible, candidates);
+
+	// the straddling leaves are gathered so their bounds still go through the wide test together
+	worldBounds.resize(candidates.size());
+	candidateVisible.resize(candidates.size());
+	for (size_t i = 0; i < candidates.size(); i++)
+		worldBounds[i] = bounds[candidates[i]];
+	Test(frustum, worldBounds.data(), worldBounds.size(), candidateVisible.data());
+	for (size_t i = 0; i < candidates.size(); i++)
+		visible[candidates[i]] = candidateVisible[i];
+
+	const auto visibleCount = static_cast<size_t>(std::count(visible, visible + count, 1));
+	frameStats.tested += nodesTested + candidates.size();
+	frameStats.visible += visibleCount;
+	frameStats.culled += count - visibleCount;
+	frameStats.cullMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	return visibleCount;
+}
+
+void FrustumCuller::EndFrame()
+{
+	lastFrameStats = frameStats;
+	frameStats = CullingStats();
+}
+
+size_t FrustumCuller::Test(const Frustum& frustum, const CullBounds* bounds, const size_t count, unsigned char* visible) const
+{
+	size_t visibleCount = 0;
+	size_t i = 0;
+#ifdef FRUSTUM_CULLER_SSE2
+	// four bounds per iteration: transposed so each register holds one component of all four, then tested against
+	// every plane at once
+	__m128 planeX[6], planeY[6], planeZ[6], planeW[6], absX[6], absY[6], absZ[6];
+	for (int p = 0; p < 6; p++)
+	{
+		const glm::vec4& plane = frustum.planes[p];
+		planeX[p] = _mm_set1_ps(plane.x);
+		planeY[p] = _mm_set1_ps(plane.y);
+		planeZ[p] = _mm_set1_ps(plane.z);
+		planeW[p] = _mm_set1_ps(plane.w);
+		absX[p] = _mm_set1_ps(std::abs(plane.x));
+		absY[p] = _mm_set1_ps(std::abs(plane.y));
+		absZ[p] = _mm_set1_ps(std::abs(plane.z));
+	}
+	const __m128 zero = _mm_setzero_ps();
+	for (; i + 4 <= count; i += 4)
+	{
+		const float* data = &bounds[i].center.x;
+		__m128 centerX = _mm_loadu_ps(data), centerY = _mm_loadu_ps(data + 8), centerZ = _mm_loadu_ps(data + 16), radius = _mm_loadu_ps(data + 24);
+		_MM_TRANSPOSE4_PS(centerX, centerY, centerZ, radius);
+		__m128 extentX = _mm_loadu_ps(data + 4), extentY = _mm_loadu_ps(data + 12), extentZ = _mm_loadu_ps(data + 20), unused = _mm_loadu_ps(data + 28);
+		_MM_TRANSPOSE4_PS(extentX, extentY, extentZ, unused);
+
+		__m128 outside = zero;
+		for (int p = 0; p < 6; p++)
+		{
+			const __m128 distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(planeX[p], centerX), _mm_mul_ps(planeY[p], centerY)),
+				_mm_add_ps(_mm_mul_ps(planeZ[p], centerZ), planeW[p]));
+			const __m128 box = _mm_add_ps(_mm_add_ps(_mm_mul_ps(absX[p], extentX), _mm_mul_ps(absY[p], extentY)), _mm_mul_ps(absZ[p], extentZ));
+			outside = _mm_or_ps(outside, _mm_cmplt_ps(_mm_add_ps(distance, _mm_min_ps(box, radius)), zero));
+		}
+
+		const int mask = _mm_movemask_ps(outside);
+		for (int lane = 0; lane < 4; lane++)
+		{
+			visible[i + lane] = (mask >> lane & 1) == 0;
+			visibleCount += visible[i + lane];
+		}
+	}
+#endif
+	for (; i < count; i++)
+	{
+		bool inside = true;
+		for (const glm::vec4& plane : frustum.planes)
+			inside = inside && glm::dot(glm::vec3(plane), bounds[i].center) + plane.w + Reach(plane, bounds[i]) >= 0.0f;
+		visible[i] = inside;
+		visibleCount += inside;
+	}
+	return visibleCount;
+}
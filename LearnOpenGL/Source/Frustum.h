@@ -0,0 +1,73 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <glm/glm.hpp>
+#include <vector>
+
+// Six planes facing inward, a point p is inside when dot(xyz, p) + w >= 0 for every one of them.
+// The planes are normalized so the same test gives distances for spheres.
+struct Frustum
+{
+	glm::vec4 planes[6]; // left, right, bottom, top, near, far
+};
+
+// Frustum of a GL clip space matrix, projection * view gives it in world space
+Frustum ExtractFrustum(const glm::mat4& viewProjection);
+// The frustum in the space transform maps from, so bounds in that space can be tested without moving them
+Frustum TransformFrustum(const Frustum& frustum, const glm::mat4& transform);
+
+// Box and sphere around the same center, an object is culled when either of them is outside
+struct CullBounds
+{
+	glm::vec3 center;
+	float radius;
+	glm::vec3 extents; // half size of the box along each axis
+	float padding;
+};
+static_assert(sizeof(CullBounds) == 8 * sizeof(float), "the culling pass loads bounds as two groups of four floats");
+
+// Bounds around the transformed bounds, the box stays axis aligned and the sphere grows with the largest scale
+CullBounds TransformBounds(const CullBounds& bounds, const glm::mat4& transform);
+
+class BoundingVolumeHierarchy;
+
+struct CullingStats
+{
+	size_t tested = 0; // bounds and hierarchy nodes
+	size_t visible = 0;
+	size_t culled = 0;
+	double cullMs = 0.0; // spent in Cull, including moving the bounds to world space
+};
+
+// Tests bounds against a frustum four at a time with SSE, falling back to one at a time without it.
+// Counts what it tested per frame the way GLState does. Like the rest of the renderer it may only be used from the GL
+// thread.
+class FrustumCuller
+{
+public:
+	static FrustumCuller& Get();
+
+	// Moves count model space bounds to world space with transform and sets visible[i] to whether bounds[i] may be in
+	// the frustum. Returns the number visible.
+	size_t Cull(const Frustum& frustum, const glm::mat4& transform, const CullBounds* bounds, size_t count, unsigned char* visible);
+	// same test on bounds that are already in world space
+	size_t Cull(const Frustum& frustum, const CullBounds* bounds, size_t count, unsigned char* visible);
+	// Same result for bounds a hierarchy was built over: subtrees entirely outside or inside the frustum are settled
+	// without looking at their bounds, only those of leaves that straddle it are tested
+	size_t Cull(const Frustum& frustum, const BoundingVolumeHierarchy& hierarchy, const CullBounds* bounds, size_t count, unsigned char* visible);
+
+	const CullingStats& GetFrameStats() const { return frameStats; }
+	const CullingStats& GetLastFrameStats() const { return lastFrameStats; }
+	// Call once per frame, moves the counts of the frame to GetLastFrameStats and starts over
+	void EndFrame();
+
+private:
+	std::vector<CullBounds> worldBounds;
+	std::vector<uint32_t> candidates;
+	std::vector<unsigned char> candidateVisible;
+	CullingStats frameStats, lastFrameStats;
+
+	FrustumCuller() = default;
+
+	size_t Test(const Frustum& frustum, const CullBounds* bounds, size_t count, unsigned char* visible) const;
+};
@@ -0,0 +1,23 @@
+#include "GLExtensions.h"
+
+namespace GLExt
+{
+	MultiDrawElementsIndirectProc MultiDrawElementsIndirect = nullptr;
+	BufferStorageProc BufferStorage = nullptr;
+	CopyImageSubDataProc CopyImageSubData = nullptr;
+}
+
+void LoadGLExtensions(const GLADloadproc load)
+{
+	// drivers hand out pointers for functions the context doesn't support, so the version decides
+	GLExt::MultiDrawElementsIndirect = HasGLVersion(4, 3)
+		? reinterpret_cast<GLExt::MultiDrawElementsIndirectProc>(load("glMultiDrawElementsIndirect")) : nullptr;
+	GLExt::CopyImageSubData = HasGLVersion(4, 3)
+		? reinterpret_cast<GLExt::CopyImageSubDataProc>(load("glCopyImageSubData")) : nullptr;
+	GLExt::BufferStorage = HasGLVersion(4, 4) ? reinterpret_cast<GLExt::BufferStorageProc>(load("glBufferStorage")) : nullptr;
+}
+
+bool HasGLVersion(const int major, const int minor)
+{
+	return GLVersion.major > major || (GLVersion.major == major && GLVersion.minor >= minor);
+}
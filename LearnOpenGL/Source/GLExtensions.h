@@ -0,0 +1,24 @@
+#pragma once
+#include <glad/glad.h>
+
+// Entry points and enums newer than the GL 3.3 the loader was generated for. LoadGLExtensions loads the ones the
+// context's version provides, the others stay null, so check a pointer before taking its path.
+namespace GLExt
+{
+	typedef void (APIENTRYP MultiDrawElementsIndirectProc)(GLenum mode, GLenum type, const void* indirect, GLsizei drawCount, GLsizei stride);
+	typedef void (APIENTRYP BufferStorageProc)(GLenum target, GLsizeiptr size, const void* data, GLbitfield flags);
+	typedef void (APIENTRYP CopyImageSubDataProc)(GLuint srcName, GLenum srcTarget, GLint srcLevel, GLint srcX, GLint srcY, GLint srcZ,
+		GLuint dstName, GLenum dstTarget, GLint dstLevel, GLint dstX, GLint dstY, GLint dstZ, GLsizei width, GLsizei height, GLsizei depth);
+
+	extern MultiDrawElementsIndirectProc MultiDrawElementsIndirect; // 4.3
+	extern CopyImageSubDataProc CopyImageSubData;                   // 4.3
+	extern BufferStorageProc BufferStorage;                         // 4.4
+
+	const GLenum DRAW_INDIRECT_BUFFER = 0x8F3F;
+	const GLbitfield MAP_PERSISTENT_BIT = 0x0040;
+	const GLbitfield MAP_COHERENT_BIT = 0x0080;
+}
+
+// Call once after gladLoadGLLoader with the same loader
+void LoadGLExtensions(GLADloadproc load);
+bool HasGLVersion(int major, int minor);
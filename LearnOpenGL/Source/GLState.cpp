@@ -0,0 +1,211 @@
+#include "GLState.h"
+#include "GLExtensions.h"
+
+#include <algorithm>
+
+GLStateCounter GLStateStats::Total() const
+{
+	GLStateCounter total;
+	for (const GLStateCounter* counter : { &programs, &vertexArrays, &activeTextures, &textures, &buffers, &capabilities, &depthMasks, &blendFuncs })
+	{
+		total.issued += counter->issued;
+		total.elided += counter->elided;
+	}
+	return total;
+}
+
+const GLuint GLState::UNKNOWN;
+
+GLState& GLState::Get()
+{
+	static GLState state;
+	return state;
+}
+
+GLState::GLState()
+	: buffers{ { GL_ARRAY_BUFFER, UNKNOWN }, { GL_ELEMENT_ARRAY_BUFFER, UNKNOWN }, { GL_UNIFORM_BUFFER, UNKNOWN },
+		{ GL_PIXEL_UNPACK_BUFFER, UNKNOWN }, { GLExt::DRAW_INDIRECT_BUFFER, UNKNOWN } },
+	capabilities{ { GL_DEPTH_TEST, -1 }, { GL_BLEND, -1 }, { GL_CULL_FACE, -1 } }
+{
+	std::fill(textures, textures + TEXTURE_UNITS, UNKNOWN);
+}
+
+bool GLState::UseProgram(const GLuint program)
+{
+	if (!Count(&GLStateStats::programs, program != this->program))
+		return false;
+	glUseProgram(program);
+	this->program = program;
+	return true;
+}
+
+bool GLState::BindVertexArray(const GLuint vertexArray)
+{
+	if (!Count(&GLStateStats::vertexArrays, vertexArray != this->vertexArray))
+		return false;
+	glBindVertexArray(vertexArray);
+	this->vertexArray = vertexArray;
+	FindBuffer(GL_ELEMENT_ARRAY_BUFFER)->buffer = UNKNOWN;
+	return true;
+}
+
+bool GLState::ActiveTexture(const unsigned int unit)
+{
+	if (!Count(&GLStateStats::activeTextures, unit != activeUnit))
+		return false;
+	glActiveTexture(GL_TEXTURE0 + unit);
+	activeUnit = unit;
+	return true;
+}
+
+bool GLState::BindTexture(const unsigned int unit, const GLuint texture)
+{
+	if (!Count(&GLStateStats::textures, unit >= TEXTURE_UNITS || textures[unit] != texture))
+		return false;
+	ActiveTexture(unit);
+	glBindTexture(GL_TEXTURE_2D, texture);
+	if (unit < TEXTURE_UNITS)
+		textures[unit] = texture;
+	return true;
+}
+
+bool GLState::BindTexture(const GLuint texture)
+{
+	if (activeUnit == UNKNOWN)
+		ActiveTexture(0);
+	return BindTexture(activeUnit, texture);
+}
+
+bool GLState::BindBuffer(const GLenum target, const GLuint buffer)
+{
+	BufferBinding* binding = FindBuffer(target);
+	if (!Count(&GLStateStats::buffers, !binding || binding->buffer != buffer))
+		return false;
+	glBindBuffer(target, buffer);
+	if (binding)
+		binding->buffer = buffer;
+	return true;
+}
+
+void GLState::BindBufferBase(const GLenum target, const GLuint index, const GLuint buffer)
+{
+	Count(&GLStateStats::buffers, true);
+	glBindBufferBase(target, index, buffer);
+	if (BufferBinding* binding = FindBuffer(target))
+		binding->buffer = buffer;
+}
+
+void GLState::BindBufferRange(const GLenum target, const GLuint index, const GLuint buffer, const GLintptr offset, const GLsizeiptr size)
+{
+	Count(&GLStateStats::buffers, true);
+	glBindBufferRange(target, index, buffer, offset, size);
+	if (BufferBinding* binding = FindBuffer(target))
+		binding->buffer = buffer;
+}
+
+bool GLState::SetEnabled(const GLenum capability, const bool enabled)
+{
+	Capability* tracked = std::find_if(capabilities, capabilities + TRACKED_CAPABILITIES,
+		[capability](const Capability& entry) { return entry.capability == capability; });
+	if (tracked == capabilities + TRACKED_CAPABILITIES)
+		tracked = nullptr;
+	if (!Count(&GLStateStats::capabilities, !tracked || tracked->enabled != static_cast<int>(enabled)))
+		return false;
+	if (enabled)
+		glEnable(capability);
+	else
+		glDisable(capability);
+	if (tracked)
+		tracked->enabled = enabled;
+	return true;
+}
+
+bool GLState::DepthMask(const bool write)
+{
+	if (!Count(&GLStateStats::depthMasks, depthMask != static_cast<int>(write)))
+		return false;
+	glDepthMask(write ? GL_TRUE : GL_FALSE);
+	depthMask = write;
+	return true;
+}
+
+bool GLState::BlendFunc(const GLenum source, const GLenum destination)
+{
+	if (!Count(&GLStateStats::blendFuncs, source != blendSource || destination != blendDestination))
+		return false;
+	glBlendFunc(source, destination);
+	blendSource = source;
+	blendDestination = destination;
+	return true;
+}
+
+void GLState::DeleteTexture(const GLuint texture)
+{
+	DeleteTextures(1, &texture);
+}
+
+void GLState::DeleteTextures(const GLsizei count, const GLuint* textures)
+{
+	glDeleteTextures(count, textures);
+	for (GLsizei i = 0; i < count; i++)
+		std::replace(this->textures, this->textures + TEXTURE_UNITS, textures[i], 0u);
+}
+
+void GLState::DeleteBuffer(const GLuint buffer)
+{
+	glDeleteBuffers(1, &buffer);
+	for (BufferBinding& binding : buffers)
+	{
+		if (binding.buffer == buffer)
+			binding.buffer = 0;
+	}
+}
+
+void GLState::DeleteVertexArray(const GLuint vertexArray)
+{
+	glDeleteVertexArrays(1, &vertexArray);
+	if (this->vertexArray == vertexArray)
+	{
+		this->vertexArray = 0;
+		FindBuffer(GL_ELEMENT_ARRAY_BUFFER)->buffer = UNKNOWN;
+	}
+}
+
+void GLState::Invalidate()
+{
+	program = vertexArray = UNKNOWN;
+	activeUnit = UNKNOWN;
+	std::fill(textures, textures + TEXTURE_UNITS, UNKNOWN);
+	for (BufferBinding& binding : buffers)
+		binding.buffer = UNKNOWN;
+	for (Capability& capability : capabilities)
+		capability.enabled = -1;
+	depthMask = -1;
+	blendSource = blendDestination = UNKNOWN;
+}
+
+void GLState::EndFrame()
+{
+	lastFrameStats = frameStats;
+	frameStats = GLStateStats();
+}
+
+GLState::BufferBinding* GLState::FindBuffer(const GLenum target)
+{
+	for (BufferBinding& binding : buffers)
+	{
+		if (binding.target == target)
+			return &binding;
+	}
+	return nullptr;
+}
+
+bool GLState::Count(GLStateCounter GLStateStats::* counter, const bool issue)
+{
+	GLStateCounter& count = frameStats.*counter;
+	if (issue)
+		count.issued++;
+	else
+		count.elided++;
+	return issue;
+}
@@ -0,0 +1,100 @@
+#pragma once
+#include <cstddef>
+#include <glad/glad.h>
+
+struct GLStateCounter
+{
+	size_t issued = 0; // calls that reached the driver
+	size_t elided = 0; // calls dropped because the state already matched
+};
+
+struct GLStateStats
+{
+	GLStateCounter programs;
+	GLStateCounter vertexArrays;
+	GLStateCounter activeTextures;
+	GLStateCounter textures;
+	GLStateCounter buffers;
+	GLStateCounter capabilities; // glEnable / glDisable
+	GLStateCounter depthMasks;
+	GLStateCounter blendFuncs;
+
+	GLStateCounter Total() const;
+};
+
+// Shadows the bindings and fixed function state the renderer changes and drops calls that wouldn't change anything.
+// Every bind and delete of programs, VAOs, textures and buffers in the project goes through here, which keeps the
+// shadow true. Code that changes this state with GL calls of its own has to call Invalidate afterwards.
+// Textures are tracked for GL_TEXTURE_2D on the first TEXTURE_UNITS units, binds to higher units always go through.
+// Like the rest of the GL resources it may only be used from the thread that owns the context.
+class GLState
+{
+public:
+	static GLState& Get();
+
+	static const unsigned int TEXTURE_UNITS = 32;
+
+	// each returns whether the call reached the driver
+	bool UseProgram(GLuint program);
+	bool BindVertexArray(GLuint vertexArray);
+	bool ActiveTexture(unsigned int unit);
+	bool BindTexture(unsigned int unit, GLuint texture);
+	// binds to the active unit, for code that is about to specify the texture rather than draw with it
+	bool BindTexture(GLuint texture);
+	// GL_ELEMENT_ARRAY_BUFFER is part of the VAO, its shadow is dropped whenever the VAO changes
+	bool BindBuffer(GLenum target, GLuint buffer);
+	// indexed bindings aren't tracked, but the call also binds the generic target
+	void BindBufferBase(GLenum target, GLuint index, GLuint buffer);
+	void BindBufferRange(GLenum target, GLuint index, GLuint buffer, GLintptr offset, GLsizeiptr size);
+	// tracks GL_DEPTH_TEST, GL_BLEND and GL_CULL_FACE, other capabilities always go through
+	bool SetEnabled(GLenum capability, bool enabled);
+	bool DepthMask(bool write);
+	bool BlendFunc(GLenum source, GLenum destination);
+
+	// delete the object and unbind it from the shadow the way the GL unbinds it from the context
+	void DeleteTexture(GLuint texture);
+	void DeleteTextures(GLsizei count, const GLuint* textures);
+	void DeleteBuffer(GLuint buffer);
+	void DeleteVertexArray(GLuint vertexArray);
+
+	// forgets everything, the next call of each kind goes through
+	void Invalidate();
+
+	const GLStateStats& GetFrameStats() const { return frameStats; }
+	const GLStateStats& GetLastFrameStats() const { return lastFrameStats; }
+	// Call once per frame, moves the counts of the frame to GetLastFrameStats and starts over
+	void EndFrame();
+
+private:
+	static const GLuint UNKNOWN = ~0u;
+	static const size_t TRACKED_BUFFERS = 5;
+	static const size_t TRACKED_CAPABILITIES = 3;
+
+	struct BufferBinding
+	{
+		GLenum target;
+		GLuint buffer;
+	};
+
+	struct Capability
+	{
+		GLenum capability;
+		int enabled; // -1 while unknown
+	};
+
+	GLuint program = UNKNOWN;
+	GLuint vertexArray = UNKNOWN;
+	unsigned int activeUnit = UNKNOWN;
+	GLuint textures[TEXTURE_UNITS];
+	BufferBinding buffers[TRACKED_BUFFERS];
+	Capability capabilities[TRACKED_CAPABILITIES];
+	int depthMask = -1;
+	GLenum blendSource = UNKNOWN;
+	GLenum blendDestination = UNKNOWN;
+	GLStateStats frameStats, lastFrameStats;
+
+	GLState();
+
+	BufferBinding* FindBuffer(GLenum target);
+	bool Count(GLStateCounter GLStateStats::* counter, bool issue);
+};
@@ -0,0 +1,92 @@
+#include "GeometryBuffer.h"
+#include "GLState.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+namespace
+{
+	// Sends the bytes past uploaded to the bound buffer. When they don't fit the buffer is reallocated with at least
+	// double the size, so without a Reserve a buffer filled a batch at a time still copies every byte a constant
+	// number of times.
+	void UploadRange(const GLenum target, const std::vector<unsigned char>& data, size_t& capacity, size_t& uploaded)
+	{
+		if (data.size() > capacity)
+		{
+			capacity = std::max({ data.size(), data.capacity(), capacity * 2 });
+			glBufferData(target, capacity, nullptr, GL_STATIC_DRAW);
+			uploaded = 0;
+		}
+		if (data.size() > uploaded)
+			glBufferSubData(target, uploaded, data.size() - uploaded, data.data() + uploaded);
+		uploaded = data.size();
+	}
+}
+
+GeometryBuffer::GeometryBuffer(const VertexFormat format) : format(format)
+{
+	glGenVertexArrays(1, &vao);
+	glGenBuffers(1, &vbo);
+	glGenBuffers(1, &ebo);
+
+	GLState& state = GLState::Get();
+	state.BindVertexArray(vao);
+	state.BindBuffer(GL_ARRAY_BUFFER, vbo);
+	state.BindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
+	SetupVertexAttributes(format);
+	state.BindVertexArray(0);
+}
+
+GeometryBuffer::~GeometryBuffer()
+{
+	GLState& state = GLState::Get();
+	state.DeleteVertexArray(vao);
+	state.DeleteBuffer(vbo);
+	state.DeleteBuffer(ebo);
+}
+
+GeometryBuffer::Allocation GeometryBuffer::Add(const void* vertices, const size_t count, const size_t vertexSize, const void* indices, const size_t indexBytes)
+{
+	const size_t expectedSize = format == VertexFormat::Packed ? sizeof(PackedVertex) : sizeof(Vertex);
+	if (vertexSize != expectedSize)
+		std::cout << "ERROR::GEOMETRYBUFFER::VERTEX FORMAT MISMATCH" << std::endl;
+
+	Allocation allocation;
+	allocation.baseVertex = static_cast<int>(vertexCount);
+
+	// 32-bit index runs have to start on a 4 byte boundary
+	indexData.resize((indexData.size() + 3) & ~static_cast<size_t>(3));
+	allocation.indexByteOffset = indexData.size();
+
+	const auto* vertexBytes = static_cast<const unsigned char*>(vertices);
+	const auto* indexBytesBegin = static_cast<const unsigned char*>(indices);
+	vertexData.insert(vertexData.end(), vertexBytes, vertexBytes + count * vertexSize);
+	indexData.insert(indexData.end(), indexBytesBegin, indexBytesBegin + indexBytes);
+	vertexCount += count;
+	return allocation;
+}
+
+void GeometryBuffer::Reserve(const size_t vertexBytes, const size_t indexBytes)
+{
+	vertexData.reserve(vertexData.size() + vertexBytes);
+	indexData.reserve(indexData.size() + indexBytes);
+}
+
+void GeometryBuffer::Upload()
+{
+	if (vertexData.size() == uploadedVertexBytes && indexData.size() == uploadedIndexBytes)
+		return;
+
+	GLState& state = GLState::Get();
+	state.BindVertexArray(vao);
+	state.BindBuffer(GL_ARRAY_BUFFER, vbo);
+	UploadRange(GL_ARRAY_BUFFER, vertexData, vertexCapacity, uploadedVertexBytes);
+	UploadRange(GL_ELEMENT_ARRAY_BUFFER, indexData, indexCapacity, uploadedIndexBytes);
+	state.BindVertexArray(0);
+}
+
+void GeometryBuffer::Bind() const
+{
+	GLState::Get().BindVertexArray(vao);
+}
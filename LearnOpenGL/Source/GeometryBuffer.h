@@ -0,0 +1,51 @@
+#pragma once
+#include "Mesh.h"
+
+#include <cstddef>
+#include <vector>
+
+// One VAO with a single vertex and index buffer shared by many meshes, so drawing them needs no VAO switches.
+// Each mesh is a (baseVertex, first index, count) range drawn with glDrawElementsBaseVertex.
+// Meshes are staged on the CPU by Add and become drawable after the next Upload, which only sends what was added since
+// the previous one. The GL buffers are sized after the staging capacity, Reserve the final size up front so meshes
+// added over several Uploads don't reallocate buffers that are already being drawn from.
+class GeometryBuffer
+{
+public:
+	explicit GeometryBuffer(VertexFormat format = VertexFormat::Full);
+	~GeometryBuffer();
+
+	GeometryBuffer(const GeometryBuffer&) = delete;
+	GeometryBuffer& operator=(const GeometryBuffer&) = delete;
+
+	struct Allocation
+	{
+		int baseVertex;
+		size_t indexByteOffset;
+	};
+
+	// vertexSize has to match the buffer's format, index data may be 16 or 32 bit
+	Allocation Add(const void* vertexData, size_t vertexCount, size_t vertexSize, const void* indexData, size_t indexBytes);
+
+	// makes room for this many more bytes of vertex and index data
+	void Reserve(size_t vertexBytes, size_t indexBytes);
+	// uploads what was added since the last call, growing the GL buffers only when it doesn't fit
+	void Upload();
+	void Bind() const;
+	unsigned int GetVertexArray() const { return vao; }
+
+	VertexFormat GetFormat() const { return format; }
+	size_t VertexBytes() const { return vertexData.size(); }
+	size_t IndexBytes() const { return indexData.size(); }
+
+private:
+	VertexFormat format;
+	std::vector<unsigned char> vertexData;
+	std::vector<unsigned char> indexData;
+	size_t vertexCount = 0;
+	size_t uploadedVertexBytes = 0;
+	size_t uploadedIndexBytes = 0;
+	size_t vertexCapacity = 0; // size of the GL buffers
+	size_t indexCapacity = 0;
+	unsigned int vao{}, vbo{}, ebo{};
+};
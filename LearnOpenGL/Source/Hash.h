@@ -0,0 +1,32 @@
+#ifndef HASH_H
+#define HASH_H
+
+#include <cstddef>
+#include <cstdint>
+
+// 64-bit FNV-1a, used for content hashes and hashed lookup keys
+const uint64_t FNV_OFFSET_BASIS = 14695981039346656037ull;
+const uint64_t FNV_PRIME = 1099511628211ull;
+
+inline uint64_t HashBytes(const void* data, const size_t size, uint64_t hash = FNV_OFFSET_BASIS)
+{
+	const auto* bytes = static_cast<const unsigned char*>(data);
+	for (size_t i = 0; i < size; i++)
+	{
+		hash ^= bytes[i];
+		hash *= FNV_PRIME;
+	}
+	return hash;
+}
+
+// Usable in constant expressions so string literals can be hashed at compile time
+constexpr uint64_t HashString(const char* str, uint64_t hash = FNV_OFFSET_BASIS)
+{
+	while (*str)
+	{
+		hash ^= static_cast<unsigned char>(*str++);
+		hash *= FNV_PRIME;
+	}
+	return hash;
+}
+#endif
@@ -0,0 +1,128 @@
+#include "IndirectDrawQueue.h"
+#include "GLExtensions.h"
+#include "GLState.h"
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <numeric>
+
+namespace
+{
+	// packed meshes dequantize with uniforms of their own, so only full format meshes can share a call
+	bool SameBatch(const Mesh& a, const Mesh& b)
+	{
+		return a.GetVertexArray() == b.GetVertexArray() && a.GetMaterialKey() == b.GetMaterialKey() && a.GetIndexType() == b.GetIndexType()
+			&& (&a == &b || a.GetVertexFormat() == VertexFormat::Full);
+	}
+}
+
+bool IsMultiDrawIndirectSupported()
+{
+	return GLExt::MultiDrawElementsIndirect != nullptr;
+}
+
+IndirectDrawQueue::~IndirectDrawQueue()
+{
+	Release();
+}
+
+void IndirectDrawQueue::Begin()
+{
+	draws.clear();
+	stats = IndirectDrawStats();
+}
+
+void IndirectDrawQueue::Submit(const Mesh& mesh, const size_t lod, const glm::mat4& transform)
+{
+	draws.push_back({ &mesh, lod, transform });
+}
+
+void IndirectDrawQueue::Execute(const Shader& shader)
+{
+	if (!IsMultiDrawIndirectSupported())
+	{
+		std::cout << "ERROR::INDIRECTDRAWQUEUE::MULTI DRAW INDIRECT NOT LOADED" << std::endl;
+		return;
+	}
+	if (draws.empty())
+		return;
+
+	const auto start = std::chrono::steady_clock::now();
+	Build();
+	stats.buildMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+	// the whole frame goes up in two uploads, glBufferData hands the driver fresh storage if the last one is in use
+	if (!commandBuffer)
+	{
+		glGenBuffers(1, &commandBuffer);
+		glGenBuffers(1, &transformBuffer);
+	}
+	GLState& state = GLState::Get();
+	state.BindBuffer(GLExt::DRAW_INDIRECT_BUFFER, commandBuffer);
+	glBufferData(GLExt::DRAW_INDIRECT_BUFFER, commands.size() * sizeof(DrawElementsIndirectCommand), commands.data(), GL_STREAM_DRAW);
+	state.BindBuffer(GL_ARRAY_BUFFER, transformBuffer);
+	glBufferData(GL_ARRAY_BUFFER, transforms.size() * sizeof(glm::mat4), transforms.data(), GL_STREAM_DRAW);
+
+	shader.Use();
+	unsigned int vertexArray = ~0u;
+	for (const Batch& batch : batches)
+	{
+		// the instance attributes are pointed at this queue's buffer on every frame, Model::DrawInstanced may share the VAO
+		if (batch.mesh->GetVertexArray() != vertexArray)
+		{
+			vertexArray = batch.mesh->GetVertexArray();
+			state.BindVertexArray(vertexArray);
+			SetupInstanceAttributes(transformBuffer);
+		}
+		batch.mesh->BindMaterial(shader);
+		batch.mesh->SetFormatUniforms(shader);
+		GLExt::MultiDrawElementsIndirect(GL_TRIANGLES, batch.mesh->GetIndexType(),
+			reinterpret_cast<const void*>(batch.firstCommand * sizeof(DrawElementsIndirectCommand)), static_cast<GLsizei>(batch.commandCount), 0);
+		stats.multiDraws++;
+	}
+}
+
+void IndirectDrawQueue::Release()
+{
+	if (commandBuffer)
+		GLState::Get().DeleteBuffer(commandBuffer);
+	if (transformBuffer)
+		GLState::Get().DeleteBuffer(transformBuffer);
+	commandBuffer = transformBuffer = 0;
+}
+
+void IndirectDrawQueue::Build()
+{
+	order.resize(draws.size());
+	std::iota(order.begin(), order.end(), 0u);
+	std::sort(order.begin(), order.end(), [this](const uint32_t a, const uint32_t b)
+	{
+		const Mesh& meshA = *draws[a].mesh;
+		const Mesh& meshB = *draws[b].mesh;
+		if (meshA.GetVertexArray() != meshB.GetVertexArray())
+			return meshA.GetVertexArray() < meshB.GetVertexArray();
+		if (meshA.GetMaterialKey() != meshB.GetMaterialKey())
+			return meshA.GetMaterialKey() < meshB.GetMaterialKey();
+		if (meshA.GetIndexType() != meshB.GetIndexType())
+			return meshA.GetIndexType() < meshB.GetIndexType();
+		return &meshA < &meshB;
+	});
+
+	transforms.clear();
+	commands.clear();
+	batches.clear();
+	for (const uint32_t index : order)
+	{
+		const Draw& draw = draws[index];
+		if (batches.empty() || !SameBatch(*batches.back().mesh, *draw.mesh))
+			batches.push_back({ draw.mesh, commands.size(), 0 });
+
+		draw.mesh->AppendIndirectCommands(draw.lod, static_cast<GLuint>(transforms.size()), commands);
+		transforms.push_back(draw.transform);
+		batches.back().commandCount = commands.size() - batches.back().firstCommand;
+	}
+
+	stats.instances = draws.size();
+	stats.commands = commands.size();
+}
@@ -0,0 +1,71 @@
+#pragma once
+#include "Mesh.h"
+#include "Shader.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <glm/glm.hpp>
+#include <vector>
+
+// true when LoadGLExtensions found glMultiDrawElementsIndirect, IndirectDrawQueue can't be used otherwise
+bool IsMultiDrawIndirectSupported();
+
+struct IndirectDrawStats
+{
+	size_t instances = 0;  // mesh instances submitted
+	size_t commands = 0;   // indirect commands, one per index range
+	size_t multiDraws = 0; // glMultiDrawElementsIndirect calls
+	double buildMs = 0.0;  // sorting and filling the command and transform buffers
+};
+
+// Draws the meshes of a frame with one glMultiDrawElementsIndirect per VAO and material instead of one call per index
+// range. The transform of a draw is an instanced attribute: every command draws a single instance whose baseInstance
+// is its index into the transform buffer, so shaders don't need gl_DrawID and ModelShaderInstanced.vert works as is.
+// Meshes sharing a GeometryBuffer batch best. Needs GL 4.3, RenderQueue is the path for 3.3 contexts.
+class IndirectDrawQueue
+{
+public:
+	IndirectDrawQueue() = default;
+	~IndirectDrawQueue();
+
+	IndirectDrawQueue(const IndirectDrawQueue&) = delete;
+	IndirectDrawQueue& operator=(const IndirectDrawQueue&) = delete;
+
+	void Begin();
+	void Submit(const Mesh& mesh, size_t lod, const glm::mat4& transform);
+	// Draws everything submitted since Begin with a shader that reads its model matrix from attributes 4 to 7
+	void Execute(const Shader& shader);
+
+	size_t Size() const { return draws.size(); }
+	const IndirectDrawStats& GetStats() const { return stats; }
+
+	// Deletes the buffers, for queues that outlive the context. They are recreated by the next Execute.
+	void Release();
+
+private:
+	struct Draw
+	{
+		const Mesh* mesh;
+		size_t lod;
+		glm::mat4 transform;
+	};
+
+	// consecutive commands drawn by one call, all with the VAO and material of mesh
+	struct Batch
+	{
+		const Mesh* mesh;
+		size_t firstCommand;
+		size_t commandCount;
+	};
+
+	std::vector<Draw> draws;
+	std::vector<uint32_t> order;
+	std::vector<glm::mat4> transforms;
+	std::vector<DrawElementsIndirectCommand> commands;
+	std::vector<Batch> batches;
+	unsigned int commandBuffer = 0, transformBuffer = 0;
+	IndirectDrawStats stats;
+
+	// sorts the draws into batches and fills commands and transforms in that order
+	void Build();
+};
@@ -1,4 +1,5 @@
 #include <iostream>
+#include <sstream>
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
 #include <glm/glm.hpp>
@@ -7,7 +8,17 @@
 
 #include "Shader.h"
 #include "Camera.h"
+#include "FrameDataRing.h"
+#include "Frustum.h"
+#include "GLExtensions.h"
+#include "GLState.h"
+#include "CameraUniforms.h"
 #include "Model.h"
+#include "RenderQueue.h"
+#include "IndirectDrawQueue.h"
+#include "TextureStreamer.h"
+#include "TextureUploadRing.h"
+#include "Benchmarks.h"
 
 const unsigned int screen_width = 1920;
 const unsigned int screen_height = 1080;
@@ -61,12 +72,17 @@ void ScrollCallback(GLFWwindow* window, double xOffset, double yOffset)
 	camera.ProcessMouseScroll(yOffset);
 }
 
-int main()
+int main(int argc, char* argv[])
 {
+	// any argument selects a headless benchmark instead of the interactive scene
+	const std::string benchmark = argc > 1 ? argv[1] : "";
+
 	glfwInit();
 	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
 	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
 	glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+	if (!benchmark.empty())
+		glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
 
 	GLFWwindow* window = glfwCreateWindow(screen_width, screen_height, "LearnOpenGL", nullptr, nullptr);
 	if (window == nullptr)
@@ -82,6 +98,19 @@ int main()
 		std::cout << "Failed to initialize GLAD" << std::endl;
 		return -1;
 	}
+	// the 4.x paths are only taken when the driver gave us a newer context for the 3.3 core request, which most desktop
+	// drivers and Mesa do
+	LoadGLExtensions(reinterpret_cast<GLADloadproc>(glfwGetProcAddress));
+	const bool multiDrawIndirect = IsMultiDrawIndirectSupported();
+
+	if (!benchmark.empty())
+	{
+		const int result = RunBenchmark(benchmark);
+		TextureUploadRing::Get().Release();
+		FrameDataRing::Get().Release();
+		glfwTerminate();
+		return result;
+	}
 
 	glfwSetFramebufferSizeCallback(window, FrameBufferSizeCallback);
 
@@ -89,11 +118,22 @@ int main()
 	glfwSetCursorPosCallback(window, MouseCallback);
 	glfwSetScrollCallback(window, ScrollCallback);
 
-	glEnable(GL_DEPTH_TEST);
+	GLState::Get().SetEnabled(GL_DEPTH_TEST, true);
 
-	const Shader ourShader("Source/Shaders/ModelShader.vert", "Source/Shaders/ModelShader.frag");
+	const Shader ourShader(multiDrawIndirect ? "Source/Shaders/ModelShaderInstanced.vert" : "Source/Shaders/ModelShader.vert", "Source/Shaders/ModelShader.frag");
+	CameraUniformBuffer cameraUniforms;
 
-	Model ourModel("resources/objects/nanosuit/nanosuit.obj");
+	// parsing and texture decoding run in the background, the model fills in over the first frames
+	ModelSettings modelSettings;
+	modelSettings.lodErrors = { 0.002f, 0.01f, 0.04f };
+	modelSettings.streamTextures = true;
+	// one VAO lets multi-draw indirect batch every mesh with the same material into one call
+	modelSettings.packGeometry = multiDrawIndirect;
+	std::shared_ptr<Model> ourModel = Model::LoadAsync("resources/objects/nanosuit/nanosuit.obj", false, modelSettings);
+	ModelLodState ourModelLods;
+	RenderQueue renderQueue;
+	IndirectDrawQueue indirectQueue;
+	float lastReport = 0.0f;
 
 	// render loop
 	while (!glfwWindowShouldClose(window))
@@ -110,24 +150,56 @@ int main()
 		glClearColor(0.05f, 0.05f, 0.05f, 1.0f);
 		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-		ourShader.Use();
-		
 		glm::mat4 projection = glm::perspective(glm::radians(camera.Zoom), static_cast<float>(screen_width)/static_cast<float>(screen_height), 0.1f, 100.0f);
 		glm::mat4 view = camera.GetViewMatrix();
-		ourShader.SetMat4("projection", projection);
-		ourShader.SetMat4("view", view);
+		cameraUniforms.Update(view, projection, camera.Position);
 
 		auto model = glm::mat4(1.0f);
 		model = glm::translate(model, glm::vec3(0.0f, -1.75f, 0.0f));
 		model = glm::scale(model, glm::vec3(0.2f, 0.2f, 0.2f));
-		ourShader.SetMat4("model", model);
-		ourModel.Draw(ourShader);
+		ourModel->Update();
+		const Frustum frustum = camera.GetFrustum(projection);
+		LodView lodView(camera.Position, glm::radians(camera.Zoom), static_cast<float>(screen_height));
+		lodView.frustum = &frustum;
+		if (multiDrawIndirect)
+		{
+			indirectQueue.Begin();
+			ourModel->Submit(indirectQueue, model, lodView, ourModelLods);
+			indirectQueue.Execute(ourShader);
+		}
+		else
+		{
+			renderQueue.Begin(camera.Position);
+			ourModel->Submit(renderQueue, ourShader, model, lodView, ourModelLods);
+			renderQueue.Execute();
+		}
+		TextureStreamer::Get().Update();
+		TextureUploadRing::Get().EndFrame();
+		FrameDataRing::Get().EndFrame();
+		GLState::Get().EndFrame();
+		FrustumCuller::Get().EndFrame();
+
+		// culling results of the last frame in the title, once a second so it stays readable
+		if (currentFrame - lastReport >= 1.0f)
+		{
+			const CullingStats& culling = FrustumCuller::Get().GetLastFrameStats();
+			std::ostringstream title;
+			title << "LearnOpenGL - " << culling.visible << " visible, " << culling.culled << " culled, " << culling.cullMs << " ms culling";
+			glfwSetWindowTitle(window, title.str().c_str());
+			lastReport = currentFrame;
+		}
 		
 		// check and call events and swap buffers
 		glfwPollEvents();
 		glfwSwapBuffers(window);
 	}
 
+	// textures and buffers have to be released while the context is still alive
+	ourModel.reset();
+	indirectQueue.Release();
+	cameraUniforms.Release();
+	FrameDataRing::Get().Release();
+	TextureUploadRing::Get().Release();
 	glfwTerminate();
 	return 0;
 }
\ No newline at end of file
@@ -0,0 +1,83 @@
+#include "Material.h"
+#include "GLState.h"
+#include "Hash.h"
+
+#include <cstdint>
+#include <iostream>
+#include <unordered_map>
+
+static_assert(MAX_SAMPLER_UNITS <= GLState::TEXTURE_UNITS, "sampler units have to stay within the texture shadow of GLState");
+
+namespace
+{
+	const std::string MATERIAL_PREFIX = "material.";
+	const std::string TEXTURE_PREFIX = "texture_";
+
+	class SamplerUnitTable
+	{
+	public:
+		SamplerUnitTable()
+		{
+			// the types Model loads come first, so their units don't depend on which shader was linked first
+			for (const std::string type : { "diffuse", "specular", "normal", "height" })
+				Reserve(type.data(), type.size(), SAMPLERS_PER_TYPE);
+		}
+
+		// First of count units for key, reserved on first use. Keys that no longer fit are remembered as invalid so
+		// they are reported only once.
+		unsigned int Reserve(const char* key, const size_t length, const unsigned int count)
+		{
+			const uint64_t hash = HashBytes(key, length);
+			const auto found = firstUnits.find(hash);
+			if (found != firstUnits.end())
+				return found->second;
+
+			if (nextUnit + count > MAX_SAMPLER_UNITS)
+			{
+				std::cout << "ERROR::MATERIAL::OUT_OF_SAMPLER_UNITS " << std::string(key, length) << std::endl;
+				firstUnits.emplace(hash, INVALID_SAMPLER_UNIT);
+				return INVALID_SAMPLER_UNIT;
+			}
+			firstUnits.emplace(hash, nextUnit);
+			nextUnit += count;
+			return nextUnit - count;
+		}
+
+	private:
+		std::unordered_map<uint64_t, unsigned int> firstUnits; // by type, or by name for samplers outside a material
+		unsigned int nextUnit = 0;
+	};
+
+	bool HasPrefix(const std::string& name, const size_t start, const std::string& prefix)
+	{
+		return name.compare(start, prefix.size(), prefix) == 0;
+	}
+}
+
+unsigned int SamplerUnit(const std::string& name)
+{
+	static SamplerUnitTable table;
+
+	size_t start = HasPrefix(name, 0, MATERIAL_PREFIX) ? MATERIAL_PREFIX.size() : 0;
+	const bool material = start > 0 || HasPrefix(name, 0, TEXTURE_PREFIX);
+	if (!material)
+		return table.Reserve(name.data(), name.size(), 1);
+	if (HasPrefix(name, start, TEXTURE_PREFIX))
+		start += TEXTURE_PREFIX.size();
+
+	// the type is followed by its number, a missing one counts as the first
+	size_t end = name.size();
+	while (end > start && name[end - 1] >= '0' && name[end - 1] <= '9')
+		end--;
+	unsigned int number = end == name.size() ? 1 : 0;
+	for (size_t i = end; i < name.size() && number <= SAMPLERS_PER_TYPE; i++)
+		number = number * 10 + static_cast<unsigned int>(name[i] - '0');
+	if (number == 0 || number > SAMPLERS_PER_TYPE)
+	{
+		std::cout << "ERROR::MATERIAL::SAMPLER_NUMBER_OUT_OF_RANGE " << name << std::endl;
+		return INVALID_SAMPLER_UNIT;
+	}
+
+	const unsigned int first = table.Reserve(name.data() + start, end - start, SAMPLERS_PER_TYPE);
+	return first == INVALID_SAMPLER_UNIT ? INVALID_SAMPLER_UNIT : first + number - 1;
+}
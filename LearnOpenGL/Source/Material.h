@@ -0,0 +1,24 @@
+#pragma once
+#include <string>
+
+// Samplers of a material are named by texture type and a number counting from 1 ("texture_diffuse1"). Each type owns
+// SAMPLERS_PER_TYPE consecutive units, so the samplers of a type may be numbered up to that.
+const unsigned int SAMPLERS_PER_TYPE = 4;
+// GL 3.3 guarantees 48 combined texture image units, every unit handed out stays below this and within GLState's shadow
+const unsigned int MAX_SAMPLER_UNITS = 32;
+// returned for a sampler that gets no unit, nothing is bound for it
+const unsigned int INVALID_SAMPLER_UNIT = ~0u;
+
+// Texture unit a sampler name is bound to. Units are handed out process-wide on first use, so a program sets its
+// sampler uniforms once after linking (see Shader) and drawing a mesh only has to bind its textures.
+// Material samplers get the unit of their type and number, with or without the "material." and "texture_" prefixes:
+// "material.diffuse", "material.texture_diffuse1" and "texture_diffuse1" share a unit. Any other name gets a unit of
+// its own. Names past SAMPLERS_PER_TYPE or MAX_SAMPLER_UNITS are reported once and get INVALID_SAMPLER_UNIT.
+unsigned int SamplerUnit(const std::string& name);
+
+// One texture of a mesh resolved to the unit its sampler reads from
+struct TextureBinding
+{
+	unsigned int unit;
+	unsigned int textureId;
+};
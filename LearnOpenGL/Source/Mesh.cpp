@@ -1,66 +1,416 @@
 ﻿#include "Mesh.h"
+#include "GeometryBuffer.h"
+#include "GLState.h"
+#include "Hash.h"
 
+#include <algorithm>
+#include <cmath>
+#include <glm/gtc/packing.hpp>
 #include <utility>
 
-Mesh::Mesh(std::vector<Vertex> vertices, std::vector<unsigned> indices, std::vector<Texture> textures)
+namespace
+{
+	int16_t QuantizeSnorm(const float value)
+	{
+		return static_cast<int16_t>(std::lround(glm::clamp(value, -1.0f, 1.0f) * 32767.0f));
+	}
+
+	// Octahedral mapping of a unit vector onto two snorm16 components
+	void EncodeOctahedral(glm::vec3 v, int16_t encoded[2])
+	{
+		const float length = std::abs(v.x) + std::abs(v.y) + std::abs(v.z);
+		// zero for meshes without tangents, NaN if Assimp couldn't derive one
+		if (!(length > 0.0f))
+		{
+			encoded[0] = encoded[1] = 0;
+			return;
+		}
+		v /= length;
+
+		glm::vec2 e(v.x, v.y);
+		if (v.z < 0.0f)
+		{
+			e = glm::vec2((1.0f - std::abs(v.y)) * (v.x >= 0.0f ? 1.0f : -1.0f),
+				(1.0f - std::abs(v.x)) * (v.y >= 0.0f ? 1.0f : -1.0f));
+		}
+		encoded[0] = QuantizeSnorm(e.x);
+		encoded[1] = QuantizeSnorm(e.y);
+	}
+
+	void PackVertices(const std::vector<Vertex>& vertices, std::vector<PackedVertex>& packed, glm::vec3& offset, glm::vec3& scale)
+	{
+		glm::vec3 minimum(0.0f), maximum(0.0f);
+		if (!vertices.empty())
+			minimum = maximum = vertices[0].position;
+		for (const Vertex& vertex : vertices)
+		{
+			minimum = glm::min(minimum, vertex.position);
+			maximum = glm::max(maximum, vertex.position);
+		}
+		offset = minimum;
+		scale = maximum - minimum;
+		const glm::vec3 quantize = 65535.0f / glm::max(scale, glm::vec3(1e-20f));
+
+		packed.resize(vertices.size());
+		for (size_t i = 0; i < vertices.size(); i++)
+		{
+			const Vertex& vertex = vertices[i];
+			PackedVertex& out = packed[i];
+			const glm::vec3 position = (vertex.position - offset) * quantize;
+			for (int c = 0; c < 3; c++)
+				out.position[c] = static_cast<uint16_t>(std::lround(glm::clamp(position[c], 0.0f, 65535.0f)));
+			const bool flipped = glm::dot(glm::cross(vertex.normal, vertex.tangent), vertex.bitangent) < 0.0f;
+			out.position[3] = flipped ? 0 : 65535;
+
+			EncodeOctahedral(vertex.normal, out.normal);
+			EncodeOctahedral(vertex.tangent, out.tangent);
+			out.texCoords[0] = glm::packHalf1x16(vertex.texCoords.x);
+			out.texCoords[1] = glm::packHalf1x16(vertex.texCoords.y);
+		}
+	}
+
+	// Split indices[begin, end) into runs that each span at most 65536 vertices. Every run is stored relative to
+	// its lowest vertex and drawn with that as the base vertex, so even large meshes usually fit in 16 bits.
+	// Returns false if a single triangle spans too much.
+	bool SplitShortRanges(const std::vector<unsigned int>& indices, const size_t begin, const size_t end, std::vector<IndexRange>& ranges)
+	{
+		const unsigned int maxShortIndex = 0xFFFF;
+		if ((end - begin) % 3 != 0)
+			return false;
+
+		size_t first = begin;
+		unsigned int low = ~0u, high = 0;
+		for (size_t t = begin; t < end; t += 3)
+		{
+			const unsigned int triangleLow = std::min({ indices[t], indices[t + 1], indices[t + 2] });
+			const unsigned int triangleHigh = std::max({ indices[t], indices[t + 1], indices[t + 2] });
+			if (triangleHigh - triangleLow > maxShortIndex || triangleHigh > static_cast<unsigned int>(INT32_MAX))
+				return false;
+
+			if (t > first && std::max(high, triangleHigh) - std::min(low, triangleLow) > maxShortIndex)
+			{
+				ranges.push_back({ first, t - first, static_cast<int>(low) });
+				first = t;
+				low = triangleLow;
+				high = triangleHigh;
+			}
+			else
+			{
+				low = std::min(low, triangleLow);
+				high = std::max(high, triangleHigh);
+			}
+		}
+
+		if (end > first)
+			ranges.push_back({ first, end - first, static_cast<int>(low) });
+		return true;
+	}
+}
+
+void SetupVertexAttributes(const VertexFormat format)
+{
+	if (format == VertexFormat::Packed)
+	{
+		// quantized positions with the bitangent sign in w
+		glEnableVertexAttribArray(0);
+		glVertexAttribPointer(0, 4, GL_UNSIGNED_SHORT, GL_TRUE, sizeof(PackedVertex), nullptr);
+
+		// octahedral normals
+		glEnableVertexAttribArray(1);
+		glVertexAttribPointer(1, 2, GL_SHORT, GL_TRUE, sizeof(PackedVertex), reinterpret_cast<void*>(offsetof(PackedVertex, normal)));
+
+		// half float texture coords
+		glEnableVertexAttribArray(2);
+		glVertexAttribPointer(2, 2, GL_HALF_FLOAT, GL_FALSE, sizeof(PackedVertex), reinterpret_cast<void*>(offsetof(PackedVertex, texCoords)));
+
+		// octahedral tangents
+		glEnableVertexAttribArray(3);
+		glVertexAttribPointer(3, 2, GL_SHORT, GL_TRUE, sizeof(PackedVertex), reinterpret_cast<void*>(offsetof(PackedVertex, tangent)));
+	}
+	else
+	{
+		// vertex positions
+		glEnableVertexAttribArray(0);
+		glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), nullptr);
+
+		// vertex normals
+		glEnableVertexAttribArray(1);
+		glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), reinterpret_cast<void*>(offsetof(Vertex, normal)));
+
+		// vertex texture coords
+		glEnableVertexAttribArray(2);
+		glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), reinterpret_cast<void*>(offsetof(Vertex, texCoords)));
+	}
+}
+
+void SetupInstanceAttributes(const unsigned int instanceBuffer)
+{
+	// a mat4 takes four consecutive vec4 attributes, each advancing once per instance
+	GLState::Get().BindBuffer(GL_ARRAY_BUFFER, instanceBuffer);
+	for (unsigned int column = 0; column < 4; column++)
+	{
+		const unsigned int attribute = INSTANCE_TRANSFORM_ATTRIBUTE + column;
+		glEnableVertexAttribArray(attribute);
+		glVertexAttribPointer(attribute, 4, GL_FLOAT, GL_FALSE, sizeof(glm::mat4), reinterpret_cast<void*>(column * sizeof(glm::vec4)));
+		glVertexAttribDivisor(attribute, 1);
+	}
+}
+
+Mesh::Mesh(std::vector<Vertex> vertices, std::vector<unsigned> indices, std::vector<Texture> textures, const VertexFormat format,
+	GeometryBuffer* geometry, std::vector<MeshLod> lods)
+	: format(format), geometry(geometry)
 {
 	this->vertices = std::move(vertices);
-	this->indices = std::move(indices);
 	this->textures = std::move(textures);
+	ResolveMaterial();
+	ComputeUvScale(indices);
+	BuildIndexBuffer(std::move(indices), std::move(lods));
+	ComputeBounds();
 
 	SetupMesh();
 }
 
-void Mesh::Draw(const Shader shader)
+void Mesh::Draw(const Shader& shader, const size_t lod)
+{
+	if (geometry)
+		geometry->Bind();
+	else
+		GLState::Get().BindVertexArray(objects.vao);
+
+	BindMaterial(shader);
+	DrawRanges(lod);
+}
+
+void Mesh::BindMaterial(const Shader& shader) const
 {
+	GLState& state = GLState::Get();
+	for (const TextureBinding& binding : material)
+		state.BindTexture(binding.unit, binding.textureId);
+	SetFormatUniforms(shader);
+}
+
+void Mesh::SetFormatUniforms(const Shader& shader) const
+{
+	if (format == VertexFormat::Packed)
+	{
+		static constexpr UniformHandle POSITION_SCALE("positionScale");
+		static constexpr UniformHandle POSITION_OFFSET("positionOffset");
+		shader.SetVec3(POSITION_SCALE, positionScale);
+		shader.SetVec3(POSITION_OFFSET, positionOffset);
+	}
+}
+
+void Mesh::DrawRanges(const size_t lod) const
+{
+	const size_t indexSize = indexType == GL_UNSIGNED_SHORT ? sizeof(uint16_t) : sizeof(unsigned int);
+	const LodLevel& level = lodLevels[lod];
+	for (size_t r = level.firstRange; r < level.firstRange + level.rangeCount; r++)
+	{
+		const IndexRange& range = drawRanges[r];
+		glDrawElementsBaseVertex(GL_TRIANGLES, static_cast<GLsizei>(range.count), indexType,
+			reinterpret_cast<void*>(indexByteOffset + range.firstIndex * indexSize), baseVertexOffset + range.baseVertex);
+	}
+}
+
+void Mesh::BuildIndexBuffer(std::vector<unsigned int> indices, std::vector<MeshLod> lods)
+{
+	// every level of detail is appended to the same buffer and becomes a contiguous slice of it
+	std::vector<size_t> levelEnds(1, indices.size());
+	std::vector<float> levelErrors(1, 0.0f);
+	for (const MeshLod& lod : lods)
+	{
+		indices.insert(indices.end(), lod.indices.begin(), lod.indices.end());
+		levelEnds.push_back(indices.size());
+		levelErrors.push_back(lod.error);
+	}
+
+	std::vector<IndexRange> ranges;
+	bool fitsShort = true;
+	size_t begin = 0;
+	lodLevels.clear();
+	for (size_t level = 0; level < levelEnds.size(); level++)
+	{
+		const size_t firstRange = ranges.size();
+		fitsShort = fitsShort && SplitShortRanges(indices, begin, levelEnds[level], ranges);
+		lodLevels.push_back({ firstRange, ranges.size() - firstRange, (levelEnds[level] - begin) / 3, levelErrors[level] });
+		begin = levelEnds[level];
+	}
+
+	if (!fitsShort)
+	{
+		// a single triangle spans too much, keep the whole mesh in 32 bits
+		indexType = GL_UNSIGNED_INT;
+		drawRanges.clear();
+		begin = 0;
+		for (size_t level = 0; level < levelEnds.size(); level++)
+		{
+			lodLevels[level].firstRange = level;
+			lodLevels[level].rangeCount = 1;
+			drawRanges.push_back({ begin, levelEnds[level] - begin, 0 });
+			begin = levelEnds[level];
+		}
+		indices32 = std::move(indices);
+		return;
+	}
+
+	indexType = GL_UNSIGNED_SHORT;
+	indices16.resize(indices.size());
+	for (const IndexRange& range : ranges)
+	{
+		for (size_t i = range.firstIndex; i < range.firstIndex + range.count; i++)
+			indices16[i] = static_cast<uint16_t>(indices[i] - range.baseVertex);
+	}
+	drawRanges = std::move(ranges);
+}
+
+void Mesh::ResolveMaterial()
+{
+	// sampler names are the texture type numbered per type, like texture_diffuse1 and texture_specular2
 	unsigned int diffuseNr = 1;
 	unsigned int specularNr = 1;
-	for (unsigned int i = 0; i < textures.size(); i++)
+	material.reserve(textures.size());
+	for (const Texture& texture : textures)
 	{
-		glActiveTexture(GL_TEXTURE0 + i);
 		std::string number;
-		std::string name = textures[i].type;
-		if (name == "texture_diffuse")
+		if (texture.type == "texture_diffuse")
 			number = std::to_string(diffuseNr++);
-		else if (name == "texture_specular")
+		else if (texture.type == "texture_specular")
 			number = std::to_string(specularNr++);
+		const unsigned int unit = SamplerUnit(texture.type + number);
+		if (unit != INVALID_SAMPLER_UNIT)
+			material.push_back({ unit, texture.id });
+	}
+	materialKey = HashBytes(material.data(), material.size() * sizeof(TextureBinding));
+}
 
-		shader.SetFloat("material." + name += number, float(i));
-		glBindTexture(GL_TEXTURE_2D, textures[i].id);
+unsigned int Mesh::GetVertexArray() const
+{
+	return geometry ? geometry->GetVertexArray() : objects.vao;
+}
+
+void Mesh::ComputeBounds()
+{
+	if (vertices.empty())
+		return;
+	glm::vec3 minimum = vertices[0].position, maximum = vertices[0].position;
+	for (const Vertex& vertex : vertices)
+	{
+		minimum = glm::min(minimum, vertex.position);
+		maximum = glm::max(maximum, vertex.position);
 	}
-	glActiveTexture(GL_TEXTURE0);
+	boundsCenter = (minimum + maximum) * 0.5f;
+	boundsExtents = (maximum - minimum) * 0.5f;
+	float radiusSquared = 0.0f;
+	for (const Vertex& vertex : vertices)
+	{
+		const glm::vec3 offset = vertex.position - boundsCenter;
+		radiusSquared = std::max(radiusSquared, glm::dot(offset, offset));
+	}
+	boundsRadius = std::sqrt(radiusSquared);
+}
 
-	// Draw mesh
-	glBindVertexArray(vao);
-	glDrawElements(GL_TRIANGLES, indices.size(), GL_UNSIGNED_INT, nullptr);
-	glBindVertexArray(0);
+void Mesh::DrawRangesInstanced(const size_t lod, const size_t instanceCount) const
+{
+	const size_t indexSize = indexType == GL_UNSIGNED_SHORT ? sizeof(uint16_t) : sizeof(unsigned int);
+	const LodLevel& level = lodLevels[lod];
+	for (size_t r = level.firstRange; r < level.firstRange + level.rangeCount; r++)
+	{
+		const IndexRange& range = drawRanges[r];
+		glDrawElementsInstancedBaseVertex(GL_TRIANGLES, static_cast<GLsizei>(range.count), indexType,
+			reinterpret_cast<void*>(indexByteOffset + range.firstIndex * indexSize), static_cast<GLsizei>(instanceCount),
+			baseVertexOffset + range.baseVertex);
+	}
+}
+
+void Mesh::AppendIndirectCommands(const size_t lod, const GLuint baseInstance, std::vector<DrawElementsIndirectCommand>& commands) const
+{
+	const size_t indexSize = indexType == GL_UNSIGNED_SHORT ? sizeof(uint16_t) : sizeof(unsigned int);
+	const LodLevel& level = lodLevels[lod];
+	for (size_t r = level.firstRange; r < level.firstRange + level.rangeCount; r++)
+	{
+		const IndexRange& range = drawRanges[r];
+		// GeometryBuffer aligns every mesh's indices to their size, so the byte offset is a whole number of indices
+		commands.push_back({ static_cast<GLuint>(range.count), 1, static_cast<GLuint>(indexByteOffset / indexSize + range.firstIndex),
+			baseVertexOffset + range.baseVertex, baseInstance });
+	}
+}
+
+void Mesh::ComputeUvScale(const std::vector<unsigned int>& indices)
+{
+	// ratio of the surface area to the area it takes up in texture space
+	double area = 0.0, uvArea = 0.0;
+	for (size_t i = 0; i + 2 < indices.size(); i += 3)
+	{
+		const Vertex& a = vertices[indices[i]];
+		const Vertex& b = vertices[indices[i + 1]];
+		const Vertex& c = vertices[indices[i + 2]];
+		area += glm::length(glm::cross(b.position - a.position, c.position - a.position));
+		const glm::vec2 uvB = b.texCoords - a.texCoords, uvC = c.texCoords - a.texCoords;
+		uvArea += std::abs(uvB.x * uvC.y - uvB.y * uvC.x);
+	}
+	uvScale = uvArea > 0.0 ? static_cast<float>(std::sqrt(area / uvArea)) : 0.0f;
 }
 
 void Mesh::SetupMesh()
 {
-	glGenVertexArrays(1, &vao);
-	glGenBuffers(1, &vbo);
-	glGenBuffers(1, &ebo);
+	std::vector<PackedVertex> packed;
+	const void* vertexData = vertices.data();
+	size_t vertexSize = sizeof(Vertex);
+	if (format == VertexFormat::Packed)
+	{
+		PackVertices(vertices, packed, positionOffset, positionScale);
+		vertexData = packed.data();
+		vertexSize = sizeof(PackedVertex);
+	}
+	vertexBufferBytes = vertices.size() * vertexSize;
+	const void* indexData = indexType == GL_UNSIGNED_SHORT ? static_cast<const void*>(indices16.data()) : indices32.data();
+
+	if (geometry)
+	{
+		// the shared buffer owns the GL objects, the mesh only remembers where its data went
+		const GeometryBuffer::Allocation allocation = geometry->Add(vertexData, vertices.size(), vertexSize, indexData, IndexBufferBytes());
+		baseVertexOffset = allocation.baseVertex;
+		indexByteOffset = allocation.indexByteOffset;
+		return;
+	}
+
+	glGenVertexArrays(1, &objects.vao);
+	glGenBuffers(1, &objects.vbo);
+	glGenBuffers(1, &objects.ebo);
 
-	glBindVertexArray(vao);
-	glBindBuffer(GL_ARRAY_BUFFER, vbo);
+	GLState& state = GLState::Get();
+	state.BindVertexArray(objects.vao);
+	state.BindBuffer(GL_ARRAY_BUFFER, objects.vbo);
+	glBufferData(GL_ARRAY_BUFFER, vertexBufferBytes, vertexData, GL_STATIC_DRAW);
 
-	glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(Vertex), &vertices[0], GL_STATIC_DRAW);
+	state.BindBuffer(GL_ELEMENT_ARRAY_BUFFER, objects.ebo);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, IndexBufferBytes(), indexData, GL_STATIC_DRAW);
 
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
-	glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), &indices[0], GL_STATIC_DRAW);
+	SetupVertexAttributes(format);
 
-	// vertex positions
-	glEnableVertexAttribArray(0);
-	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), nullptr);
+	state.BindVertexArray(0);
+}
 
-	// vertex normals
-	glEnableVertexAttribArray(1);
-	glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), reinterpret_cast<void*>(offsetof(Vertex, normal)));
+Mesh::VertexArrayObjects::VertexArrayObjects(VertexArrayObjects&& other) noexcept
+	: vao(std::exchange(other.vao, 0)), vbo(std::exchange(other.vbo, 0)), ebo(std::exchange(other.ebo, 0))
+{
+}
 
-	// vertex texture coords
-	glEnableVertexAttribArray(2);
-	glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), reinterpret_cast<void*>(offsetof(Vertex, texCoords)));
+Mesh::VertexArrayObjects& Mesh::VertexArrayObjects::operator=(VertexArrayObjects&& other) noexcept
+{
+	std::swap(vao, other.vao);
+	std::swap(vbo, other.vbo);
+	std::swap(ebo, other.ebo);
+	return *this;
+}
 
-	glBindVertexArray(0);
+Mesh::VertexArrayObjects::~VertexArrayObjects()
+{
+	// meshes in a geometry buffer never created any
+	if (!vao)
+		return;
+	GLState& state = GLState::Get();
+	state.DeleteVertexArray(vao);
+	state.DeleteBuffer(vbo);
+	state.DeleteBuffer(ebo);
 }
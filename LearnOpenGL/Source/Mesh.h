@@ -1,4 +1,6 @@
 ﻿#pragma once
+#include <cstddef>
+#include <cstdint>
 #include <vector>
 #include <glm/glm.hpp>
 #include <string>
@@ -13,6 +15,21 @@ struct Vertex
 	glm::vec3 bitangent;
 };
 
+// Compact vertex layout, 20 bytes instead of the 56 of Vertex
+struct PackedVertex
+{
+	uint16_t position[4];  // unorm16 within the mesh bounds, see Mesh::positionScale. w holds the bitangent sign
+	int16_t normal[2];     // octahedral snorm16
+	int16_t tangent[2];    // octahedral snorm16
+	uint16_t texCoords[2]; // half float
+};
+
+enum class VertexFormat
+{
+	Full,  // Vertex, uploaded as is
+	Packed // PackedVertex, needs a shader that dequantizes positions and rebuilds the tangent frame (ModelShaderPacked.vert)
+};
+
 struct Texture
 {
 	unsigned int id;
@@ -20,21 +37,157 @@ struct Texture
 	std::string path;
 };
 
+// A material texture as referenced by the source asset, before it is loaded
+struct TextureRef
+{
+	std::string type;
+	std::string path;
+};
+
+// Simplified triangle list sharing the vertices of its mesh
+struct MeshLod
+{
+	std::vector<unsigned int> indices;
+	float error; // furthest the surface moved from the full resolution mesh, in mesh units
+};
+
+// CPU-side result of importing one mesh, independent of any GL state
+struct MeshData
+{
+	std::vector<Vertex> vertices;
+	std::vector<unsigned int> indices;
+	std::vector<TextureRef> textures;
+	std::vector<MeshLod> lods; // coarser levels after the full resolution indices, ordered from fine to coarse
+};
+
+class GeometryBuffer;
+
+// Configures the attribute pointers of the currently bound VAO for a vertex layout
+void SetupVertexAttributes(VertexFormat format);
+// Points attributes 4 to 7 of the currently bound VAO at a buffer holding one mat4 per instance
+void SetupInstanceAttributes(unsigned int instanceBuffer);
+const unsigned int INSTANCE_TRANSFORM_ATTRIBUTE = 4;
+
+// Contiguous run of a mesh's index buffer drawn with one call, its indices are relative to baseVertex
+struct IndexRange
+{
+	size_t firstIndex;
+	size_t count;
+	int baseVertex;
+};
+
+// One draw of glMultiDrawElementsIndirect, laid out the way the GL reads it from GL_DRAW_INDIRECT_BUFFER
+struct DrawElementsIndirectCommand
+{
+	GLuint count;
+	GLuint instanceCount;
+	GLuint firstIndex; // in indices of the draw's index type, not bytes
+	GLint baseVertex;
+	GLuint baseInstance;
+};
+
 class Mesh
 {
 public:
 	// Mesh Data
 	std::vector<Vertex> vertices;
-	std::vector<unsigned int> indices;
 	std::vector<Texture> textures;
 
 	// Functions
-	Mesh(std::vector<Vertex> vertices, std::vector<unsigned int> indices, std::vector<Texture> textures);
-	void Draw(Shader shader);
+	// with a geometry buffer the mesh is appended to it instead of getting its own VAO, see GeometryBuffer.
+	// lods are stored after the full resolution indices in the same index buffer.
+	Mesh(std::vector<Vertex> vertices, std::vector<unsigned int> indices, std::vector<Texture> textures, VertexFormat format = VertexFormat::Full,
+		GeometryBuffer* geometry = nullptr, std::vector<MeshLod> lods = std::vector<MeshLod>());
+	// a mesh owns its GL objects, so it can be moved but not copied
+	Mesh(const Mesh&) = delete;
+	Mesh& operator=(const Mesh&) = delete;
+	Mesh(Mesh&&) = default;
+	Mesh& operator=(Mesh&&) = default;
+	void Draw(const Shader& shader, size_t lod = 0);
+
+	// Draw split in its parts, for callers that bind the VAO of a shared geometry buffer once for many meshes
+	// binds the textures to the units their samplers were resolved to at construction, see SamplerUnit,
+	// and sets the uniforms the vertex format needs
+	void BindMaterial(const Shader& shader) const;
+	void SetFormatUniforms(const Shader& shader) const;
+	const std::vector<TextureBinding>& GetMaterial() const { return material; }
+	// identical for meshes with the same texture bindings
+	uint64_t GetMaterialKey() const { return materialKey; }
+	// the VAO to bind before DrawRanges, shared by every mesh of a geometry buffer
+	unsigned int GetVertexArray() const;
+	void DrawRanges(size_t lod = 0) const;
+	// every range once per instance, the VAO needs instance attributes, see SetupInstanceAttributes
+	void DrawRangesInstanced(size_t lod, size_t instanceCount) const;
+	// one command per range of the level, every one a single instance starting at baseInstance
+	void AppendIndirectCommands(size_t lod, GLuint baseInstance, std::vector<DrawElementsIndirectCommand>& commands) const;
+
+	// level 0 is the full resolution mesh
+	size_t LodCount() const { return lodLevels.size(); }
+	float LodError(const size_t lod) const { return lodLevels[lod].error; }
+	size_t TriangleCount(const size_t lod = 0) const { return lodLevels[lod].triangleCount; }
+	// box and sphere around the vertex positions in model space, both centered on the box
+	const glm::vec3& GetBoundsCenter() const { return boundsCenter; }
+	const glm::vec3& GetBoundsExtents() const { return boundsExtents; }
+	float GetBoundsRadius() const { return boundsRadius; }
+	// model space length covered by one unit of texture coordinates, averaged over the surface. 0 without texture coordinates.
+	float GetUvScale() const { return uvScale; }
+
+	VertexFormat GetVertexFormat() const { return format; }
+	size_t VertexBufferBytes() const { return vertexBufferBytes; }
+	size_t IndexCount() const { return indices16.size() + indices32.size(); }
+	size_t IndexBufferBytes() const { return indices16.size() * sizeof(uint16_t) + indices32.size() * sizeof(unsigned int); }
+	GLenum GetIndexType() const { return indexType; }
+	GeometryBuffer* GetGeometryBuffer() const { return geometry; }
 private:
+	// The VAO and buffers of a mesh outside a geometry buffer, deleted with the mesh and handed over when it moves
+	struct VertexArrayObjects
+	{
+		unsigned int vao = 0, vbo = 0, ebo = 0;
+
+		VertexArrayObjects() = default;
+		VertexArrayObjects(VertexArrayObjects&& other) noexcept;
+		VertexArrayObjects& operator=(VertexArrayObjects&& other) noexcept;
+		~VertexArrayObjects();
+	};
+
 	// Render data
-	unsigned int vao{}, vbo{}, ebo{};
+	VertexArrayObjects objects;
+	VertexFormat format;
+	GeometryBuffer* geometry;
+	// where the mesh starts inside a shared geometry buffer
+	int baseVertexOffset = 0;
+	size_t indexByteOffset = 0;
+	size_t vertexBufferBytes = 0;
+	// packed positions are stored relative to the mesh bounds: position = positionOffset + quantized * positionScale
+	glm::vec3 positionScale{ 1.0f };
+	glm::vec3 positionOffset{ 0.0f };
+
+	// index data in the narrowest type that fits, only one of the two is filled
+	std::vector<uint16_t> indices16;
+	std::vector<unsigned int> indices32;
+	std::vector<IndexRange> drawRanges;
+	GLenum indexType = GL_UNSIGNED_INT;
+
+	// every level of detail draws a slice of drawRanges
+	struct LodLevel
+	{
+		size_t firstRange;
+		size_t rangeCount;
+		size_t triangleCount;
+		float error;
+	};
+	std::vector<LodLevel> lodLevels;
+	std::vector<TextureBinding> material;
+	uint64_t materialKey = 0;
+	glm::vec3 boundsCenter{ 0.0f };
+	glm::vec3 boundsExtents{ 0.0f };
+	float boundsRadius = 0.0f;
+	float uvScale = 0.0f;
 
 	// Functions
+	void BuildIndexBuffer(std::vector<unsigned int> indices, std::vector<MeshLod> lods);
+	void ResolveMaterial();
+	void ComputeBounds();
+	void ComputeUvScale(const std::vector<unsigned int>& indices);
 	void SetupMesh();
 };
@@ -0,0 +1,273 @@
+#include "MeshCache.h"
+#include "Hash.h"
+#include "MappedFile.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+namespace
+{
+	const char CACHE_MAGIC[4] = { 'L', 'M', 'S', 'H' };
+
+	struct CacheHeader
+	{
+		char magic[4];
+		uint32_t version;
+		uint64_t sourceHash;
+		uint32_t importKey;
+		uint32_t vertexSize;
+		uint32_t meshCount;
+		uint32_t nodeCount;
+		uint32_t dependencyCount;
+	};
+
+	struct MeshHeader
+	{
+		uint32_t vertexCount;
+		uint32_t indexCount;
+		uint32_t textureCount;
+		uint32_t lodCount;
+	};
+
+	struct LodHeader
+	{
+		uint32_t indexCount;
+		float error;
+	};
+
+	// Bounds-checked cursor over the mapped cache file, so a truncated or corrupt file is rejected instead of read past
+	class CacheReader
+	{
+	public:
+		CacheReader(const unsigned char* data, const size_t size) : data(data), size(size) {}
+
+		const unsigned char* Take(const size_t bytes)
+		{
+			const size_t aligned = (bytes + 3) & ~static_cast<size_t>(3);
+			if (aligned > size - offset)
+				return nullptr;
+			const unsigned char* result = data + offset;
+			offset += aligned;
+			return result;
+		}
+
+		bool ReadString(std::string& str)
+		{
+			const unsigned char* length = Take(sizeof(uint32_t));
+			if (!length)
+				return false;
+			uint32_t count;
+			std::memcpy(&count, length, sizeof(count));
+			const unsigned char* chars = Take(count);
+			if (!chars)
+				return false;
+			str.assign(reinterpret_cast<const char*>(chars), count);
+			return true;
+		}
+
+	private:
+		const unsigned char* data;
+		size_t size;
+		size_t offset = 0;
+	};
+
+	// an index past the vertices would be read and drawn out of bounds, which no valid entry has
+	bool IndicesInRange(const std::vector<unsigned int>& indices, const size_t vertexCount)
+	{
+		return std::all_of(indices.begin(), indices.end(), [vertexCount](const unsigned int index) { return index < vertexCount; });
+	}
+
+	void WritePadded(std::ofstream& out, const void* data, const size_t bytes)
+	{
+		static const char padding[4] = {};
+		out.write(static_cast<const char*>(data), bytes);
+		out.write(padding, (4 - bytes % 4) % 4);
+	}
+
+	void WriteString(std::ofstream& out, const std::string& str)
+	{
+		const auto length = static_cast<uint32_t>(str.size());
+		out.write(reinterpret_cast<const char*>(&length), sizeof(length));
+		WritePadded(out, str.data(), str.size());
+	}
+}
+
+std::string MeshCache::CachePath(const std::string& sourcePath)
+{
+	return sourcePath + ".meshcache";
+}
+
+uint64_t MeshCache::HashSource(const std::string& sourcePath)
+{
+	const MappedFile source(sourcePath);
+	if (!source.IsOpen())
+		return 0;
+	return HashBytes(source.Data(), source.Size());
+}
+
+bool MeshCache::Load(const std::string& sourcePath, const uint64_t sourceHash, const uint32_t importKey, std::vector<MeshData>& meshes,
+	std::vector<SceneNode>& nodes)
+{
+	const MappedFile cache(CachePath(sourcePath));
+	if (!cache.IsOpen() || sourceHash == 0)
+		return false;
+
+	CacheReader reader(cache.Data(), cache.Size());
+	const unsigned char* headerData = reader.Take(sizeof(CacheHeader));
+	if (!headerData)
+		return false;
+
+	CacheHeader header;
+	std::memcpy(&header, headerData, sizeof(header));
+	if (std::memcmp(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC)) != 0 || header.version != VERSION ||
+		header.sourceHash != sourceHash || header.importKey != importKey || header.vertexSize != sizeof(Vertex) ||
+		static_cast<size_t>(header.meshCount) * sizeof(MeshHeader) > cache.Size())
+		return false;
+
+	// every file the import read has to be unchanged too, checked before any mesh is copied out
+	for (uint32_t i = 0; i < header.dependencyCount; i++)
+	{
+		std::string dependency;
+		const unsigned char* hashData = reader.ReadString(dependency) ? reader.Take(sizeof(uint64_t)) : nullptr;
+		if (!hashData)
+			return false;
+		uint64_t dependencyHash;
+		std::memcpy(&dependencyHash, hashData, sizeof(dependencyHash));
+		if (HashSource(dependency) != dependencyHash)
+			return false;
+	}
+
+	std::vector<MeshData> loaded(header.meshCount);
+	for (MeshData& mesh : loaded)
+	{
+		const unsigned char* meshData = reader.Take(sizeof(MeshHeader));
+		if (!meshData)
+			return false;
+		MeshHeader meshHeader;
+		std::memcpy(&meshHeader, meshData, sizeof(meshHeader));
+
+		// vertex and index arrays are stored exactly as they are laid out in memory, so each is a single copy out of the mapping
+		const unsigned char* vertexData = reader.Take(static_cast<size_t>(meshHeader.vertexCount) * sizeof(Vertex));
+		const unsigned char* indexData = reader.Take(static_cast<size_t>(meshHeader.indexCount) * sizeof(unsigned int));
+		if (!vertexData || !indexData)
+			return false;
+		mesh.vertices.resize(meshHeader.vertexCount);
+		mesh.indices.resize(meshHeader.indexCount);
+		std::memcpy(mesh.vertices.data(), vertexData, mesh.vertices.size() * sizeof(Vertex));
+		std::memcpy(mesh.indices.data(), indexData, mesh.indices.size() * sizeof(unsigned int));
+		if (!IndicesInRange(mesh.indices, mesh.vertices.size()))
+			return false;
+
+		if (meshHeader.lodCount > cache.Size() / sizeof(LodHeader))
+			return false;
+		mesh.lods.resize(meshHeader.lodCount);
+		for (MeshLod& lod : mesh.lods)
+		{
+			const unsigned char* lodData = reader.Take(sizeof(LodHeader));
+			if (!lodData)
+				return false;
+			LodHeader lodHeader;
+			std::memcpy(&lodHeader, lodData, sizeof(lodHeader));
+			const unsigned char* lodIndices = reader.Take(static_cast<size_t>(lodHeader.indexCount) * sizeof(unsigned int));
+			if (!lodIndices)
+				return false;
+			lod.indices.resize(lodHeader.indexCount);
+			std::memcpy(lod.indices.data(), lodIndices, lod.indices.size() * sizeof(unsigned int));
+			if (!IndicesInRange(lod.indices, mesh.vertices.size()))
+				return false;
+			lod.error = lodHeader.error;
+		}
+
+		mesh.textures.resize(meshHeader.textureCount);
+		for (TextureRef& texture : mesh.textures)
+		{
+			if (!reader.ReadString(texture.type) || !reader.ReadString(texture.path))
+				return false;
+		}
+	}
+
+	// the node hierarchy follows the meshes, stored as it is laid out in memory
+	const unsigned char* nodeData = reader.Take(static_cast<size_t>(header.nodeCount) * sizeof(SceneNode));
+	if (!nodeData)
+		return false;
+	nodes.resize(header.nodeCount);
+	std::memcpy(nodes.data(), nodeData, nodes.size() * sizeof(SceneNode));
+
+	meshes = std::move(loaded);
+	return true;
+}
+
+bool MeshCache::Store(const std::string& sourcePath, const uint64_t sourceHash, const uint32_t importKey, const std::vector<std::string>& dependencies,
+	const std::vector<MeshData>& meshes, const std::vector<SceneNode>& nodes)
+{
+	if (sourceHash == 0)
+		return false;
+
+	// write to a temporary file first so a partially written cache is never picked up
+	const std::string cachePath = CachePath(sourcePath);
+	const std::string tempPath = cachePath + ".tmp";
+	{
+		std::ofstream out(tempPath, std::ios::binary | std::ios::trunc);
+		if (!out)
+		{
+			std::cout << "ERROR::MESHCACHE::COULD NOT WRITE " << tempPath << std::endl;
+			return false;
+		}
+
+		CacheHeader header{};
+		std::memcpy(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC));
+		header.version = VERSION;
+		header.sourceHash = sourceHash;
+		header.importKey = importKey;
+		header.vertexSize = sizeof(Vertex);
+		header.meshCount = static_cast<uint32_t>(meshes.size());
+		header.nodeCount = static_cast<uint32_t>(nodes.size());
+		header.dependencyCount = static_cast<uint32_t>(dependencies.size());
+		out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+		for (const std::string& dependency : dependencies)
+		{
+			// a dependency that can't be read hashes to 0, which never matches on load
+			const uint64_t dependencyHash = HashSource(dependency);
+			WriteString(out, dependency);
+			out.write(reinterpret_cast<const char*>(&dependencyHash), sizeof(dependencyHash));
+		}
+
+		for (const MeshData& mesh : meshes)
+		{
+			MeshHeader meshHeader{};
+			meshHeader.vertexCount = static_cast<uint32_t>(mesh.vertices.size());
+			meshHeader.indexCount = static_cast<uint32_t>(mesh.indices.size());
+			meshHeader.textureCount = static_cast<uint32_t>(mesh.textures.size());
+			meshHeader.lodCount = static_cast<uint32_t>(mesh.lods.size());
+			out.write(reinterpret_cast<const char*>(&meshHeader), sizeof(meshHeader));
+
+			WritePadded(out, mesh.vertices.data(), mesh.vertices.size() * sizeof(Vertex));
+			WritePadded(out, mesh.indices.data(), mesh.indices.size() * sizeof(unsigned int));
+			for (const MeshLod& lod : mesh.lods)
+			{
+				const LodHeader lodHeader{ static_cast<uint32_t>(lod.indices.size()), lod.error };
+				out.write(reinterpret_cast<const char*>(&lodHeader), sizeof(lodHeader));
+				WritePadded(out, lod.indices.data(), lod.indices.size() * sizeof(unsigned int));
+			}
+			for (const TextureRef& texture : mesh.textures)
+			{
+				WriteString(out, texture.type);
+				WriteString(out, texture.path);
+			}
+		}
+		WritePadded(out, nodes.data(), nodes.size() * sizeof(SceneNode));
+
+		if (!out)
+		{
+			std::cout << "ERROR::MESHCACHE::COULD NOT WRITE " << tempPath << std::endl;
+			return false;
+		}
+	}
+
+	std::remove(cachePath.c_str());
+	return std::rename(tempPath.c_str(), cachePath.c_str()) == 0;
+}
@@ -0,0 +1,30 @@
+#pragma once
+#include "Mesh.h"
+#include "SceneGraph.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Versioned on-disk cache of imported mesh data, stored next to the source asset.
+// An entry is only valid for the exact source file contents and import settings it was built from, and for the
+// contents of every other file the import read, like the material library of an .obj.
+class MeshCache
+{
+public:
+	// bump whenever the file layout or the import pipeline output changes
+	static const uint32_t VERSION = 5;
+
+	static std::string CachePath(const std::string& sourcePath);
+
+	// hash of the source file contents, 0 if the file can't be read
+	static uint64_t HashSource(const std::string& sourcePath);
+
+	// fills meshes and nodes and returns true only if a cache entry matching sourceHash and importKey exists and none of
+	// its dependencies changed since it was stored
+	static bool Load(const std::string& sourcePath, uint64_t sourceHash, uint32_t importKey, std::vector<MeshData>& meshes,
+		std::vector<SceneNode>& nodes);
+	// dependencies are the other files the import read, their contents are hashed into the entry
+	static bool Store(const std::string& sourcePath, uint64_t sourceHash, uint32_t importKey, const std::vector<std::string>& dependencies,
+		const std::vector<MeshData>& meshes, const std::vector<SceneNode>& nodes);
+};
@@ -0,0 +1,99 @@
+#include "MeshImport.h"
+
+#include <cstddef>
+#include <cstring>
+
+#if defined(_M_X64) || defined(__SSE2__)
+#include <emmintrin.h>
+#define MESH_IMPORT_SSE2
+#endif
+
+static_assert(sizeof(aiVector3D) == 3 * sizeof(float), "bulk vertex import expects single precision Assimp vectors");
+static_assert(sizeof(Vertex) == 14 * sizeof(float) && offsetof(Vertex, normal) == 3 * sizeof(float) &&
+	offsetof(Vertex, texCoords) == 6 * sizeof(float) && offsetof(Vertex, tangent) == 8 * sizeof(float),
+	"bulk vertex import expects Vertex to be tightly packed floats");
+
+namespace
+{
+	const aiVector3D ZERO_VECTOR(0.0f, 0.0f, 0.0f);
+
+	void ImportVertex(const aiVector3D& position, const aiVector3D& normal, const aiVector3D& texCoord, const aiVector3D& tangent,
+		const aiVector3D& bitangent, Vertex& vertex)
+	{
+		vertex.position = glm::vec3(position.x, position.y, position.z);
+		vertex.normal = glm::vec3(normal.x, normal.y, normal.z);
+		vertex.texCoords = glm::vec2(texCoord.x, texCoord.y);
+		vertex.tangent = glm::vec3(tangent.x, tangent.y, tangent.z);
+		vertex.bitangent = glm::vec3(bitangent.x, bitangent.y, bitangent.z);
+	}
+}
+
+void ImportVertices(const aiMesh& mesh, std::vector<Vertex>& vertices)
+{
+	const unsigned int count = mesh.mNumVertices;
+	vertices.resize(count);
+	if (count == 0)
+		return;
+
+	// missing attributes read a zero vector instead of branching per vertex
+	const aiVector3D* positions = mesh.mVertices;
+	const aiVector3D* normals = mesh.mNormals ? mesh.mNormals : &ZERO_VECTOR;
+	const aiVector3D* texCoords = mesh.mTextureCoords[0] ? mesh.mTextureCoords[0] : &ZERO_VECTOR;
+	// aiProcess_CalcTangentSpace fills tangents and bitangents together, meshes without texture coordinates get neither
+	const aiVector3D* tangents = mesh.mTangents && mesh.mBitangents ? mesh.mTangents : &ZERO_VECTOR;
+	const aiVector3D* bitangents = mesh.mTangents && mesh.mBitangents ? mesh.mBitangents : &ZERO_VECTOR;
+	const unsigned int normalStride = mesh.mNormals ? 1 : 0;
+	const unsigned int texCoordStride = mesh.mTextureCoords[0] ? 1 : 0;
+	const unsigned int tangentStride = mesh.mTangents && mesh.mBitangents ? 1 : 0;
+
+	unsigned int i = 0;
+#ifdef MESH_IMPORT_SSE2
+	// Unaligned 4-wide loads and stores move each 3-component attribute in one instruction.
+	// The fourth lane spills into the next field of the same Vertex, which is written afterwards,
+	// so stores go in field order. Loads read one float past the source element, which is why
+	// the last vertex (and any vertex without a real stride) takes the scalar path. The bitangent store spills into the
+	// position of the next vertex, which its own iteration overwrites.
+	if (normalStride && texCoordStride && tangentStride)
+	{
+		auto* out = reinterpret_cast<float*>(vertices.data());
+		const auto* position = reinterpret_cast<const float*>(positions);
+		const auto* normal = reinterpret_cast<const float*>(normals);
+		const auto* texCoord = reinterpret_cast<const float*>(texCoords);
+		const auto* tangent = reinterpret_cast<const float*>(tangents);
+		const auto* bitangent = reinterpret_cast<const float*>(bitangents);
+		for (; i + 1 < count; i++, out += 14, position += 3, normal += 3, texCoord += 3, tangent += 3, bitangent += 3)
+		{
+			_mm_storeu_ps(out + 0, _mm_loadu_ps(position));
+			_mm_storeu_ps(out + 3, _mm_loadu_ps(normal));
+			_mm_storeu_ps(out + 6, _mm_loadu_ps(texCoord));
+			_mm_storeu_ps(out + 8, _mm_loadu_ps(tangent));
+			_mm_storeu_ps(out + 11, _mm_loadu_ps(bitangent));
+		}
+	}
+#endif
+	for (; i < count; i++)
+		ImportVertex(positions[i], normals[i * normalStride], texCoords[i * texCoordStride], tangents[i * tangentStride], bitangents[i * tangentStride],
+			vertices[i]);
+}
+
+void ImportIndices(const aiMesh& mesh, std::vector<unsigned int>& indices)
+{
+	// after aiProcess_Triangulate every face of a triangle mesh has exactly three indices
+	size_t count = 0;
+	if (mesh.mPrimitiveTypes == aiPrimitiveType_TRIANGLE)
+		count = static_cast<size_t>(mesh.mNumFaces) * 3;
+	else
+	{
+		for (unsigned int i = 0; i < mesh.mNumFaces; i++)
+			count += mesh.mFaces[i].mNumIndices;
+	}
+
+	indices.resize(count);
+	unsigned int* out = indices.data();
+	for (unsigned int i = 0; i < mesh.mNumFaces; i++)
+	{
+		const aiFace& face = mesh.mFaces[i];
+		std::memcpy(out, face.mIndices, face.mNumIndices * sizeof(unsigned int));
+		out += face.mNumIndices;
+	}
+}
@@ -0,0 +1,10 @@
+#pragma once
+#include "Mesh.h"
+
+#include <assimp/mesh.h>
+#include <vector>
+
+// Bulk conversion of Assimp mesh arrays into the layout uploaded by Mesh.
+// Each output is sized exactly once and filled in place, so a mesh costs one allocation per array.
+void ImportVertices(const aiMesh& mesh, std::vector<Vertex>& vertices);
+void ImportIndices(const aiMesh& mesh, std::vector<unsigned int>& indices);
@@ -0,0 +1,280 @@
+#include "MeshOptimizer.h"
+
+#include <algorithm>
+#include <glm/geometric.hpp>
+
+namespace
+{
+	// Triangles using each vertex, stored as one flat array with per-vertex offsets
+	struct TriangleAdjacency
+	{
+		std::vector<unsigned int> offsets;
+		std::vector<unsigned int> triangles;
+
+		TriangleAdjacency(const std::vector<unsigned int>& indices, const size_t vertexCount)
+			: offsets(vertexCount + 1, 0), triangles(indices.size())
+		{
+			for (const unsigned int index : indices)
+				offsets[index + 1]++;
+			for (size_t v = 0; v < vertexCount; v++)
+				offsets[v + 1] += offsets[v];
+
+			std::vector<unsigned int> fill(offsets.begin(), offsets.end() - 1);
+			for (size_t i = 0; i < indices.size(); i++)
+				triangles[fill[indices[i]]++] = static_cast<unsigned int>(i / 3);
+		}
+	};
+
+	// FIFO cache: a vertex is resident while fewer than cacheSize misses happened since it was loaded
+	class CacheSimulator
+	{
+	public:
+		CacheSimulator(const size_t vertexCount, const unsigned int cacheSize)
+			: loadedAt(vertexCount, 0), cacheSize(cacheSize), time(cacheSize + 1) {}
+
+		bool Access(const unsigned int vertex)
+		{
+			if (time - loadedAt[vertex] <= cacheSize)
+				return false;
+			loadedAt[vertex] = time++;
+			return true;
+		}
+
+		void Reset()
+		{
+			// jumping ahead evicts everything without touching the per-vertex state
+			time += cacheSize + 1;
+		}
+
+	private:
+		std::vector<size_t> loadedAt;
+		size_t cacheSize;
+		size_t time;
+	};
+}
+
+VertexCacheStats AnalyzeVertexCache(const std::vector<unsigned int>& indices, const size_t vertexCount, const unsigned int cacheSize)
+{
+	CacheSimulator cache(vertexCount, cacheSize);
+	std::vector<bool> referenced(vertexCount, false);
+	size_t misses = 0;
+	size_t uniqueVertices = 0;
+	for (const unsigned int index : indices)
+	{
+		if (cache.Access(index))
+			misses++;
+		if (!referenced[index])
+		{
+			referenced[index] = true;
+			uniqueVertices++;
+		}
+	}
+
+	const size_t triangleCount = indices.size() / 3;
+	VertexCacheStats stats;
+	stats.acmr = triangleCount ? static_cast<float>(misses) / triangleCount : 0.0f;
+	stats.atvr = uniqueVertices ? static_cast<float>(misses) / uniqueVertices : 0.0f;
+	return stats;
+}
+
+void OptimizeVertexCache(std::vector<unsigned int>& indices, const size_t vertexCount, const unsigned int cacheSize, std::vector<unsigned int>* clusterStarts)
+{
+	const size_t triangleCount = indices.size() / 3;
+	const TriangleAdjacency adjacency(indices, vertexCount);
+
+	std::vector<unsigned int> liveTriangles(vertexCount);
+	for (size_t v = 0; v < vertexCount; v++)
+		liveTriangles[v] = adjacency.offsets[v + 1] - adjacency.offsets[v];
+
+	std::vector<size_t> cacheTime(vertexCount, 0);
+	std::vector<bool> emitted(triangleCount, false);
+	std::vector<unsigned int> deadEnd;
+	std::vector<unsigned int> candidates;
+	std::vector<unsigned int> output;
+	output.reserve(indices.size());
+
+	size_t timestamp = cacheSize + 1;
+	size_t cursor = 0;
+	long long fanning = vertexCount ? 0 : -1;
+	if (clusterStarts)
+		clusterStarts->assign(1, 0);
+
+	while (fanning >= 0)
+	{
+		// emit every remaining triangle around the fanning vertex
+		candidates.clear();
+		const auto f = static_cast<unsigned int>(fanning);
+		for (unsigned int a = adjacency.offsets[f]; a < adjacency.offsets[f + 1]; a++)
+		{
+			const unsigned int triangle = adjacency.triangles[a];
+			if (emitted[triangle])
+				continue;
+			for (unsigned int corner = 0; corner < 3; corner++)
+			{
+				const unsigned int v = indices[triangle * 3 + corner];
+				output.push_back(v);
+				deadEnd.push_back(v);
+				candidates.push_back(v);
+				liveTriangles[v]--;
+				if (timestamp - cacheTime[v] > cacheSize)
+					cacheTime[v] = timestamp++;
+			}
+			emitted[triangle] = true;
+		}
+
+		// prefer the candidate that is still in the cache and will stay there while its fan is emitted
+		long long next = -1;
+		long long bestPriority = -1;
+		for (const unsigned int v : candidates)
+		{
+			if (liveTriangles[v] == 0)
+				continue;
+			long long priority = 0;
+			if (timestamp - cacheTime[v] + 2 * liveTriangles[v] <= cacheSize)
+				priority = static_cast<long long>(timestamp - cacheTime[v]);
+			if (priority > bestPriority)
+			{
+				bestPriority = priority;
+				next = v;
+			}
+		}
+
+		if (next == -1)
+		{
+			// dead end: fall back to recently used vertices, then to the input order
+			while (!deadEnd.empty() && next == -1)
+			{
+				const unsigned int v = deadEnd.back();
+				deadEnd.pop_back();
+				if (liveTriangles[v] > 0)
+					next = v;
+			}
+			while (next == -1 && cursor < vertexCount)
+			{
+				if (liveTriangles[cursor] > 0)
+					next = static_cast<long long>(cursor);
+				cursor++;
+			}
+			const auto restart = static_cast<unsigned int>(output.size() / 3);
+			if (next != -1 && clusterStarts && clusterStarts->back() != restart)
+				clusterStarts->push_back(restart);
+		}
+		fanning = next;
+	}
+
+	indices.swap(output);
+}
+
+void OptimizeOverdraw(std::vector<unsigned int>& indices, const std::vector<Vertex>& vertices, const std::vector<unsigned int>& clusterStarts,
+	const unsigned int cacheSize, const float threshold)
+{
+	const auto triangleCount = static_cast<unsigned int>(indices.size() / 3);
+	if (triangleCount == 0)
+		return;
+
+	// split the hard clusters further wherever the run so far is already about as cache friendly as the whole mesh
+	const float meshAcmr = AnalyzeVertexCache(indices, vertices.size(), cacheSize).acmr;
+	std::vector<unsigned int> clusters;
+	CacheSimulator cache(vertices.size(), cacheSize);
+	size_t nextHard = 0;
+	unsigned int clusterMisses = 0;
+	unsigned int clusterTriangles = 0;
+	for (unsigned int t = 0; t < triangleCount; t++)
+	{
+		bool hardStart = false;
+		while (nextHard < clusterStarts.size() && clusterStarts[nextHard] <= t)
+			hardStart = clusterStarts[nextHard++] == t;
+		if (t == 0 || hardStart || (clusterTriangles > 0 && clusterMisses <= threshold * meshAcmr * clusterTriangles))
+		{
+			clusters.push_back(t);
+			cache.Reset();
+			clusterMisses = 0;
+			clusterTriangles = 0;
+		}
+		for (unsigned int corner = 0; corner < 3; corner++)
+			clusterMisses += cache.Access(indices[t * 3 + corner]) ? 1 : 0;
+		clusterTriangles++;
+	}
+	clusters.push_back(triangleCount);
+
+	// area weighted centroid and normal of every cluster
+	glm::vec3 meshCentroid(0.0f);
+	for (const Vertex& vertex : vertices)
+		meshCentroid += vertex.position;
+	meshCentroid /= static_cast<float>(std::max<size_t>(vertices.size(), 1));
+
+	const size_t clusterCount = clusters.size() - 1;
+	std::vector<float> sortKeys(clusterCount);
+	for (size_t c = 0; c < clusterCount; c++)
+	{
+		glm::vec3 centroid(0.0f);
+		glm::vec3 normal(0.0f);
+		float area = 0.0f;
+		for (unsigned int t = clusters[c]; t < clusters[c + 1]; t++)
+		{
+			const glm::vec3& a = vertices[indices[t * 3 + 0]].position;
+			const glm::vec3& b = vertices[indices[t * 3 + 1]].position;
+			const glm::vec3& p = vertices[indices[t * 3 + 2]].position;
+			const glm::vec3 weightedNormal = glm::cross(b - a, p - a);
+			const float triangleArea = glm::length(weightedNormal);
+			centroid += (a + b + p) * (triangleArea / 3.0f);
+			normal += weightedNormal;
+			area += triangleArea;
+		}
+		if (area > 0.0f)
+			centroid /= area;
+		const float normalLength = glm::length(normal);
+		if (normalLength > 0.0f)
+			normal /= normalLength;
+		sortKeys[c] = glm::dot(centroid - meshCentroid, normal);
+	}
+
+	// clusters facing away from the mesh center are the likely occluders, draw them first
+	std::vector<size_t> order(clusterCount);
+	for (size_t c = 0; c < clusterCount; c++)
+		order[c] = c;
+	std::stable_sort(order.begin(), order.end(), [&](const size_t a, const size_t b) { return sortKeys[a] > sortKeys[b]; });
+
+	std::vector<unsigned int> output;
+	output.reserve(indices.size());
+	for (const size_t c : order)
+		output.insert(output.end(), indices.begin() + clusters[c] * 3, indices.begin() + clusters[c + 1] * 3);
+	indices.swap(output);
+}
+
+void OptimizeVertexFetch(std::vector<Vertex>& vertices, std::vector<unsigned int>& indices)
+{
+	const unsigned int unused = ~0u;
+	std::vector<unsigned int> remap(vertices.size(), unused);
+	std::vector<Vertex> output;
+	output.reserve(vertices.size());
+	for (unsigned int& index : indices)
+	{
+		if (remap[index] == unused)
+		{
+			remap[index] = static_cast<unsigned int>(output.size());
+			output.push_back(vertices[index]);
+		}
+		index = remap[index];
+	}
+	vertices.swap(output);
+}
+
+MeshOptimizeReport OptimizeMesh(MeshData& mesh)
+{
+	MeshOptimizeReport report;
+	report.before = AnalyzeVertexCache(mesh.indices, mesh.vertices.size());
+	if (mesh.indices.size() % 3 != 0)
+	{
+		report.after = report.before;
+		return report;
+	}
+
+	std::vector<unsigned int> clusterStarts;
+	OptimizeVertexCache(mesh.indices, mesh.vertices.size(), VERTEX_CACHE_SIZE, &clusterStarts);
+	OptimizeOverdraw(mesh.indices, mesh.vertices, clusterStarts);
+	OptimizeVertexFetch(mesh.vertices, mesh.indices);
+
+	report.after = AnalyzeVertexCache(mesh.indices, mesh.vertices.size());
+	return report;
+}
@@ -0,0 +1,40 @@
+#pragma once
+#include "Mesh.h"
+
+#include <vector>
+
+// Import-time reordering of triangle lists for the post-transform vertex cache, overdraw and vertex fetch.
+// All passes keep the mesh visually identical, they only change the order of triangles and vertices.
+
+const unsigned int VERTEX_CACHE_SIZE = 16;
+
+struct VertexCacheStats
+{
+	float acmr; // average cache miss ratio, transformed vertices per triangle (0.5 - 3.0)
+	float atvr; // average transform to vertex ratio, transformed vertices per referenced vertex (1.0 is optimal)
+};
+
+// Simulates a FIFO post-transform cache over a triangle list
+VertexCacheStats AnalyzeVertexCache(const std::vector<unsigned int>& indices, size_t vertexCount, unsigned int cacheSize = VERTEX_CACHE_SIZE);
+
+// Tipsify (Sander et al. 2007). If clusterStarts is given it receives the first triangle of every run that
+// had to restart at a dead end, those are the points where the order can be changed without hurting the cache.
+void OptimizeVertexCache(std::vector<unsigned int>& indices, size_t vertexCount, unsigned int cacheSize = VERTEX_CACHE_SIZE,
+	std::vector<unsigned int>* clusterStarts = nullptr);
+
+// Splits the cache-optimized order into clusters and sorts them so outward facing clusters are drawn first.
+// threshold bounds how much worse than the input the ACMR of every cluster may get.
+void OptimizeOverdraw(std::vector<unsigned int>& indices, const std::vector<Vertex>& vertices, const std::vector<unsigned int>& clusterStarts,
+	unsigned int cacheSize = VERTEX_CACHE_SIZE, float threshold = 1.05f);
+
+// Renumbers vertices in order of first use and drops unreferenced ones
+void OptimizeVertexFetch(std::vector<Vertex>& vertices, std::vector<unsigned int>& indices);
+
+struct MeshOptimizeReport
+{
+	VertexCacheStats before;
+	VertexCacheStats after;
+};
+
+// Runs all three passes on a triangle list, meshes with other primitives are left untouched
+MeshOptimizeReport OptimizeMesh(MeshData& mesh);
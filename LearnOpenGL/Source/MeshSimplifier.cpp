@@ -0,0 +1,344 @@
+#include "MeshSimplifier.h"
+#include "MeshOptimizer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+namespace
+{
+	// Sum of squared distances to a set of planes, stored as the symmetric matrix A, vector b and scalar c of
+	// p·Ap + 2b·p + c. The weight is the summed plane weight so errors can be averaged back into a distance.
+	struct Quadric
+	{
+		double a00 = 0.0, a11 = 0.0, a22 = 0.0, a10 = 0.0, a20 = 0.0, a21 = 0.0;
+		double b0 = 0.0, b1 = 0.0, b2 = 0.0;
+		double c = 0.0;
+		double weight = 0.0;
+
+		void AddPlane(const glm::dvec3& normal, const double distance, const double planeWeight)
+		{
+			a00 += planeWeight * normal.x * normal.x;
+			a11 += planeWeight * normal.y * normal.y;
+			a22 += planeWeight * normal.z * normal.z;
+			a10 += planeWeight * normal.y * normal.x;
+			a20 += planeWeight * normal.z * normal.x;
+			a21 += planeWeight * normal.z * normal.y;
+			b0 += planeWeight * normal.x * distance;
+			b1 += planeWeight * normal.y * distance;
+			b2 += planeWeight * normal.z * distance;
+			c += planeWeight * distance * distance;
+			weight += planeWeight;
+		}
+
+		void Add(const Quadric& other)
+		{
+			a00 += other.a00; a11 += other.a11; a22 += other.a22;
+			a10 += other.a10; a20 += other.a20; a21 += other.a21;
+			b0 += other.b0; b1 += other.b1; b2 += other.b2;
+			c += other.c;
+			weight += other.weight;
+		}
+
+		// weighted mean squared distance of p to the planes
+		double Error(const glm::dvec3& p) const
+		{
+			const double rx = a00 * p.x + a10 * p.y + a20 * p.z;
+			const double ry = a10 * p.x + a11 * p.y + a21 * p.z;
+			const double rz = a20 * p.x + a21 * p.y + a22 * p.z;
+			const double error = p.x * rx + p.y * ry + p.z * rz + 2.0 * (b0 * p.x + b1 * p.y + b2 * p.z) + c;
+			return weight > 0.0 ? std::abs(error) / weight : 0.0;
+		}
+	};
+
+	enum class VertexKind : unsigned char
+	{
+		Manifold, // free to collapse onto any neighbour
+		Border,   // on an open edge, may only collapse along it
+		Locked    // shares its position with other vertices, moving it would tear a seam
+	};
+
+	// Maps every vertex to the first vertex with the same position, so the simplifier works on the welded surface
+	std::vector<unsigned int> RemapPositions(const std::vector<Vertex>& vertices)
+	{
+		std::vector<unsigned int> order(vertices.size());
+		for (size_t v = 0; v < vertices.size(); v++)
+			order[v] = static_cast<unsigned int>(v);
+
+		const auto less = [&](const unsigned int a, const unsigned int b)
+		{
+			const glm::vec3& pa = vertices[a].position;
+			const glm::vec3& pb = vertices[b].position;
+			if (pa.x != pb.x)
+				return pa.x < pb.x;
+			if (pa.y != pb.y)
+				return pa.y < pb.y;
+			if (pa.z != pb.z)
+				return pa.z < pb.z;
+			return a < b;
+		};
+		std::sort(order.begin(), order.end(), less);
+
+		std::vector<unsigned int> remap(vertices.size());
+		for (size_t i = 0; i < order.size(); i++)
+		{
+			const bool same = i > 0 && vertices[order[i]].position == vertices[order[i - 1]].position;
+			remap[order[i]] = same ? remap[order[i - 1]] : order[i];
+		}
+		return remap;
+	}
+
+	uint64_t EdgeKey(const unsigned int from, const unsigned int to)
+	{
+		return static_cast<uint64_t>(from) << 32 | to;
+	}
+
+	struct Collapse
+	{
+		unsigned int from;
+		unsigned int to;
+		double error;
+	};
+}
+
+float MeshExtent(const std::vector<Vertex>& vertices)
+{
+	if (vertices.empty())
+		return 0.0f;
+	glm::vec3 minimum = vertices[0].position, maximum = vertices[0].position;
+	for (const Vertex& vertex : vertices)
+	{
+		minimum = glm::min(minimum, vertex.position);
+		maximum = glm::max(maximum, vertex.position);
+	}
+	const glm::vec3 size = maximum - minimum;
+	return std::max(size.x, std::max(size.y, size.z));
+}
+
+std::vector<unsigned int> SimplifyMesh(const std::vector<Vertex>& vertices, const std::vector<unsigned int>& indices, const size_t targetIndexCount,
+	const float targetError, float* resultError)
+{
+	std::vector<unsigned int> result(indices);
+	if (resultError)
+		*resultError = 0.0f;
+	const double extent = MeshExtent(vertices);
+	if (result.size() % 3 != 0 || result.size() <= targetIndexCount || extent == 0.0)
+		return result;
+
+	const size_t vertexCount = vertices.size();
+	const std::vector<unsigned int> remap = RemapPositions(vertices);
+	std::vector<unsigned int> copies(vertexCount, 0);
+	for (size_t v = 0; v < vertexCount; v++)
+		copies[remap[v]]++;
+
+	const auto position = [&](const unsigned int v) { return glm::dvec3(vertices[v].position); };
+
+	std::vector<uint64_t> edges;
+	const auto hasEdge = [&](const unsigned int from, const unsigned int to)
+	{
+		return std::binary_search(edges.begin(), edges.end(), EdgeKey(from, to));
+	};
+	const auto buildEdges = [&]
+	{
+		// directed edges of the welded surface, an edge whose reverse is missing lies on a border
+		edges.clear();
+		for (size_t t = 0; t < result.size(); t += 3)
+		{
+			for (size_t corner = 0; corner < 3; corner++)
+				edges.push_back(EdgeKey(remap[result[t + corner]], remap[result[t + (corner + 1) % 3]]));
+		}
+		std::sort(edges.begin(), edges.end());
+	};
+
+	// every vertex starts with the planes of its triangles, weighted by area, and border edges add a plane
+	// perpendicular to their triangle so the border resists being pulled inwards
+	const double borderWeight = 10.0;
+	std::vector<Quadric> quadrics(vertexCount);
+	buildEdges();
+	for (size_t t = 0; t < result.size(); t += 3)
+	{
+		const unsigned int corners[3] = { remap[result[t]], remap[result[t + 1]], remap[result[t + 2]] };
+		const glm::dvec3 p0 = position(corners[0]), p1 = position(corners[1]), p2 = position(corners[2]);
+		const glm::dvec3 cross = glm::cross(p1 - p0, p2 - p0);
+		const double doubleArea = glm::length(cross);
+		if (doubleArea == 0.0)
+			continue;
+		const glm::dvec3 normal = cross / doubleArea;
+
+		Quadric plane;
+		plane.AddPlane(normal, -glm::dot(normal, p0), doubleArea * 0.5);
+		for (size_t corner = 0; corner < 3; corner++)
+		{
+			quadrics[corners[corner]].Add(plane);
+
+			const unsigned int from = corners[corner], to = corners[(corner + 1) % 3];
+			if (hasEdge(to, from))
+				continue;
+			const glm::dvec3 edge = position(to) - position(from);
+			const double length = glm::length(edge);
+			if (length == 0.0)
+				continue;
+			const glm::dvec3 borderNormal = glm::normalize(glm::cross(edge, normal));
+			Quadric border;
+			border.AddPlane(borderNormal, -glm::dot(borderNormal, position(from)), length * length * borderWeight);
+			quadrics[from].Add(border);
+			quadrics[to].Add(border);
+		}
+	}
+
+	const double maxError = static_cast<double>(targetError) * extent;
+	double largestError = 0.0;
+	std::vector<VertexKind> kinds(vertexCount);
+	std::vector<Collapse> collapses;
+	std::vector<unsigned int> collapseTarget(vertexCount);
+	std::vector<bool> touched(vertexCount);
+	std::vector<unsigned int> adjacencyOffsets(vertexCount + 1);
+	std::vector<unsigned int> adjacency;
+
+	while (result.size() > targetIndexCount)
+	{
+		if (edges.empty())
+			buildEdges();
+
+		std::fill(kinds.begin(), kinds.end(), VertexKind::Manifold);
+		for (size_t v = 0; v < vertexCount; v++)
+		{
+			if (copies[remap[v]] > 1)
+				kinds[remap[v]] = VertexKind::Locked;
+		}
+		for (const uint64_t edge : edges)
+		{
+			const auto from = static_cast<unsigned int>(edge >> 32), to = static_cast<unsigned int>(edge);
+			if (hasEdge(to, from))
+				continue;
+			if (kinds[from] != VertexKind::Locked)
+				kinds[from] = VertexKind::Border;
+			if (kinds[to] != VertexKind::Locked)
+				kinds[to] = VertexKind::Border;
+		}
+
+		// Candidates keep the actual vertex indices of the triangle, so merging into a seam vertex picks the copy on
+		// the same side of the seam. Collapses always merge onto the target position, which keeps its attributes valid.
+		collapses.clear();
+		for (size_t t = 0; t < result.size(); t += 3)
+		{
+			for (size_t corner = 0; corner < 3; corner++)
+			{
+				const unsigned int a = result[t + corner], b = result[t + (corner + 1) % 3];
+				const unsigned int directions[2][2] = { { a, b }, { b, a } };
+				for (const auto& direction : directions)
+				{
+					const unsigned int from = remap[direction[0]], to = remap[direction[1]];
+					if (from == to || kinds[from] == VertexKind::Locked)
+						continue;
+					if (kinds[from] == VertexKind::Border && hasEdge(from, to) && hasEdge(to, from))
+						continue;
+
+					Quadric merged = quadrics[from];
+					merged.Add(quadrics[to]);
+					collapses.push_back({ direction[0], direction[1], merged.Error(position(to)) });
+				}
+			}
+		}
+		std::sort(collapses.begin(), collapses.end(), [](const Collapse& a, const Collapse& b) { return a.error < b.error; });
+
+		// triangles around every welded vertex, used to reject collapses that would flip a face
+		std::fill(adjacencyOffsets.begin(), adjacencyOffsets.end(), 0);
+		for (const unsigned int index : result)
+			adjacencyOffsets[remap[index] + 1]++;
+		for (size_t v = 0; v < vertexCount; v++)
+			adjacencyOffsets[v + 1] += adjacencyOffsets[v];
+		adjacency.resize(result.size());
+		std::vector<unsigned int> fill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+		for (size_t i = 0; i < result.size(); i++)
+			adjacency[fill[remap[result[i]]]++] = static_cast<unsigned int>(i / 3);
+
+		const auto flips = [&](const unsigned int from, const unsigned int to)
+		{
+			const glm::dvec3 target = position(to);
+			for (unsigned int a = adjacencyOffsets[from]; a < adjacencyOffsets[from + 1]; a++)
+			{
+				const size_t t = adjacency[a] * 3;
+				const unsigned int corners[3] = { remap[result[t]], remap[result[t + 1]], remap[result[t + 2]] };
+				if (corners[0] == to || corners[1] == to || corners[2] == to)
+					continue;
+				glm::dvec3 p[3] = { position(corners[0]), position(corners[1]), position(corners[2]) };
+				const glm::dvec3 before = glm::cross(p[1] - p[0], p[2] - p[0]);
+				for (size_t corner = 0; corner < 3; corner++)
+				{
+					if (corners[corner] == from)
+						p[corner] = target;
+				}
+				const glm::dvec3 after = glm::cross(p[1] - p[0], p[2] - p[0]);
+				if (glm::dot(before, after) <= 0.0)
+					return true;
+			}
+			return false;
+		};
+
+		// an interior collapse removes two triangles, only take as many per pass as the target still needs
+		const size_t trianglesToRemove = (result.size() - targetIndexCount) / 3;
+		const size_t collapseGoal = std::max<size_t>(trianglesToRemove / 2, 1);
+		for (size_t v = 0; v < vertexCount; v++)
+			collapseTarget[v] = static_cast<unsigned int>(v);
+		std::fill(touched.begin(), touched.end(), false);
+
+		size_t collapsed = 0;
+		for (const Collapse& collapse : collapses)
+		{
+			if (collapsed >= collapseGoal || collapse.error > maxError * maxError)
+				break;
+			const unsigned int from = remap[collapse.from], to = remap[collapse.to];
+			if (touched[from] || touched[to] || flips(from, to))
+				continue;
+
+			// unlocked vertices have a single copy, so redirecting that one moves the whole welded vertex
+			collapseTarget[collapse.from] = collapse.to;
+			quadrics[to].Add(quadrics[from]);
+			touched[from] = touched[to] = true;
+			largestError = std::max(largestError, collapse.error);
+			collapsed++;
+		}
+		if (collapsed == 0)
+			break;
+
+		size_t write = 0;
+		for (size_t t = 0; t < result.size(); t += 3)
+		{
+			const unsigned int a = collapseTarget[result[t]], b = collapseTarget[result[t + 1]], c = collapseTarget[result[t + 2]];
+			if (remap[a] == remap[b] || remap[b] == remap[c] || remap[a] == remap[c])
+				continue;
+			result[write++] = a;
+			result[write++] = b;
+			result[write++] = c;
+		}
+		result.resize(write);
+		edges.clear();
+	}
+
+	if (resultError)
+		*resultError = static_cast<float>(std::sqrt(largestError) / extent);
+	return result;
+}
+
+void GenerateLods(MeshData& mesh, const std::vector<float>& maxErrors, const bool optimizeVertexCache)
+{
+	mesh.lods.clear();
+	const float extent = MeshExtent(mesh.vertices);
+	size_t previousCount = mesh.indices.size();
+	float previousError = 0.0f;
+	for (const float maxError : maxErrors)
+	{
+		// every level starts from the full mesh so its error is measured against the original surface
+		float error = 0.0f;
+		std::vector<unsigned int> indices = SimplifyMesh(mesh.vertices, mesh.indices, previousCount / 6 * 3, maxError, &error);
+		if (indices.empty() || indices.size() > previousCount * 9 / 10)
+			continue;
+
+		if (optimizeVertexCache)
+			OptimizeVertexCache(indices, mesh.vertices.size());
+		previousCount = indices.size();
+		previousError = std::max(previousError, error * extent);
+		mesh.lods.push_back({ std::move(indices), previousError });
+	}
+}
@@ -0,0 +1,22 @@
+#pragma once
+#include "Mesh.h"
+
+#include <vector>
+
+// Import-time level of detail generation by quadric error edge collapse (Garland and Heckbert 1997).
+// Vertices are never moved or created, every collapse merges a vertex into one of its neighbours, so the
+// simplified index lists keep sharing the vertex buffer of the full resolution mesh.
+
+// Largest side of the mesh bounds, simplification errors are given relative to it
+float MeshExtent(const std::vector<Vertex>& vertices);
+
+// Collapses edges cheapest first until the triangle list is down to targetIndexCount or the next collapse would move
+// the surface further than targetError. Vertices on texture or normal seams stay where they are and border vertices
+// only slide along the border, so the silhouette of open meshes and the UV layout survive. resultError receives the
+// largest error that was accepted.
+std::vector<unsigned int> SimplifyMesh(const std::vector<Vertex>& vertices, const std::vector<unsigned int>& indices, size_t targetIndexCount,
+	float targetError, float* resultError = nullptr);
+
+// Fills mesh.lods with one level per threshold, each aiming for half the triangles of the previous level. Levels that
+// hardly remove anything are skipped, so a mesh can end up with fewer levels than thresholds.
+void GenerateLods(MeshData& mesh, const std::vector<float>& maxErrors, bool optimizeVertexCache);
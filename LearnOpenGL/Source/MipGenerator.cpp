@@ -0,0 +1,233 @@
+#include "MipGenerator.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+
+#if defined(_M_X64) || defined(__SSE2__)
+#include <emmintrin.h>
+#define MIP_GENERATOR_SSE2
+#endif
+
+namespace
+{
+	// One RGBA texel in linear float, the kernels below process all four channels at once
+#ifdef MIP_GENERATOR_SSE2
+	struct Texel
+	{
+		__m128 v;
+	};
+
+	inline Texel LoadTexel(const float* texel) { return { _mm_loadu_ps(texel) }; }
+	inline void StoreTexel(float* texel, const Texel value) { _mm_storeu_ps(texel, value.v); }
+	inline Texel MulAdd(const Texel sum, const Texel value, const float weight) { return { _mm_add_ps(sum.v, _mm_mul_ps(value.v, _mm_set1_ps(weight))) }; }
+	inline Texel Average(const Texel a, const Texel b, const Texel c, const Texel d)
+	{
+		return { _mm_mul_ps(_mm_add_ps(_mm_add_ps(a.v, b.v), _mm_add_ps(c.v, d.v)), _mm_set1_ps(0.25f)) };
+	}
+#else
+	struct Texel
+	{
+		float v[4];
+	};
+
+	inline Texel LoadTexel(const float* texel) { return { { texel[0], texel[1], texel[2], texel[3] } }; }
+	inline void StoreTexel(float* texel, const Texel value) { std::copy(value.v, value.v + 4, texel); }
+	inline Texel MulAdd(const Texel sum, const Texel value, const float weight)
+	{
+		Texel result;
+		for (int c = 0; c < 4; c++)
+			result.v[c] = sum.v[c] + value.v[c] * weight;
+		return result;
+	}
+	inline Texel Average(const Texel a, const Texel b, const Texel c, const Texel d)
+	{
+		Texel result;
+		for (int i = 0; i < 4; i++)
+			result.v[i] = (a.v[i] + b.v[i] + c.v[i] + d.v[i]) * 0.25f;
+		return result;
+	}
+#endif
+
+	const int KAISER_TAPS = 6;
+	const int LINEAR_STEPS = 16384;
+
+	double BesselI0(const double x)
+	{
+		double sum = 1.0, term = 1.0;
+		for (int k = 1; k < 32; k++)
+		{
+			term *= (x / (2.0 * k)) * (x / (2.0 * k));
+			sum += term;
+		}
+		return sum;
+	}
+
+	// Weights of the six source texels around the center of a destination texel, at offsets -2.5 to 2.5.
+	// A sinc that halves the frequency, windowed with Kaiser (alpha 4) to a radius of three texels.
+	struct KaiserKernel
+	{
+		float weights[KAISER_TAPS];
+
+		KaiserKernel()
+		{
+			const double pi = 3.14159265358979323846;
+			const double radius = 3.0, beta = 4.0;
+			double sum = 0.0;
+			double raw[KAISER_TAPS];
+			for (int k = 0; k < KAISER_TAPS; k++)
+			{
+				const double x = k - 2.5;
+				const double sinc = std::sin(pi * x * 0.5) / (pi * x * 0.5);
+				const double window = BesselI0(beta * std::sqrt(1.0 - (x / radius) * (x / radius))) / BesselI0(beta);
+				raw[k] = sinc * window;
+				sum += raw[k];
+			}
+			for (int k = 0; k < KAISER_TAPS; k++)
+				weights[k] = static_cast<float>(raw[k] / sum);
+		}
+	};
+
+	struct ColorTables
+	{
+		float srgbToLinear[256];
+		unsigned char linearToSrgb[LINEAR_STEPS + 1];
+
+		ColorTables()
+		{
+			for (int i = 0; i < 256; i++)
+			{
+				const double c = i / 255.0;
+				srgbToLinear[i] = static_cast<float>(c <= 0.04045 ? c / 12.92 : std::pow((c + 0.055) / 1.055, 2.4));
+			}
+			for (int i = 0; i <= LINEAR_STEPS; i++)
+			{
+				const double c = static_cast<double>(i) / LINEAR_STEPS;
+				const double encoded = c <= 0.0031308 ? c * 12.92 : 1.055 * std::pow(c, 1.0 / 2.4) - 0.055;
+				linearToSrgb[i] = static_cast<unsigned char>(std::lround(encoded * 255.0));
+			}
+		}
+	};
+
+	const KaiserKernel& Kaiser()
+	{
+		static const KaiserKernel kernel;
+		return kernel;
+	}
+
+	const ColorTables& Tables()
+	{
+		static const ColorTables tables;
+		return tables;
+	}
+
+	void DownsampleBox(const float* source, const int width, const int height, float* destination, const int mipWidth, const int mipHeight)
+	{
+		for (int y = 0; y < mipHeight; y++)
+		{
+			const float* row0 = source + static_cast<size_t>(std::min(y * 2, height - 1)) * width * 4;
+			const float* row1 = source + static_cast<size_t>(std::min(y * 2 + 1, height - 1)) * width * 4;
+			float* out = destination + static_cast<size_t>(y) * mipWidth * 4;
+			for (int x = 0; x < mipWidth; x++)
+			{
+				const int x0 = std::min(x * 2, width - 1) * 4, x1 = std::min(x * 2 + 1, width - 1) * 4;
+				StoreTexel(out + x * 4, Average(LoadTexel(row0 + x0), LoadTexel(row0 + x1), LoadTexel(row1 + x0), LoadTexel(row1 + x1)));
+			}
+		}
+	}
+
+	// Separable: a horizontal pass into scratch at the new width, then a vertical pass that accumulates whole rows
+	void DownsampleKaiser(const float* source, const int width, const int height, float* destination, const int mipWidth, const int mipHeight,
+		std::vector<float>& scratch)
+	{
+		const float* weights = Kaiser().weights;
+		scratch.resize(static_cast<size_t>(mipWidth) * height * 4);
+		for (int y = 0; y < height; y++)
+		{
+			const float* row = source + static_cast<size_t>(y) * width * 4;
+			float* out = scratch.data() + static_cast<size_t>(y) * mipWidth * 4;
+			for (int x = 0; x < mipWidth; x++)
+			{
+				Texel sum = {};
+				for (int k = 0; k < KAISER_TAPS; k++)
+				{
+					const int sourceX = std::min(std::max(x * 2 - 2 + k, 0), width - 1);
+					sum = MulAdd(sum, LoadTexel(row + sourceX * 4), weights[k]);
+				}
+				StoreTexel(out + x * 4, sum);
+			}
+		}
+
+		for (int y = 0; y < mipHeight; y++)
+		{
+			float* out = destination + static_cast<size_t>(y) * mipWidth * 4;
+			std::fill(out, out + static_cast<size_t>(mipWidth) * 4, 0.0f);
+			for (int k = 0; k < KAISER_TAPS; k++)
+			{
+				const int sourceY = std::min(std::max(y * 2 - 2 + k, 0), height - 1);
+				const float* row = scratch.data() + static_cast<size_t>(sourceY) * mipWidth * 4;
+				for (int x = 0; x < mipWidth; x++)
+					StoreTexel(out + x * 4, MulAdd(LoadTexel(out + x * 4), LoadTexel(row + x * 4), weights[k]));
+			}
+		}
+	}
+
+	unsigned char EncodeChannel(const float value, const bool srgb)
+	{
+		const float clamped = std::min(std::max(value, 0.0f), 1.0f);
+		if (srgb)
+			return Tables().linearToSrgb[static_cast<int>(clamped * LINEAR_STEPS + 0.5f)];
+		return static_cast<unsigned char>(clamped * 255.0f + 0.5f);
+	}
+}
+
+std::vector<MipLevel> GenerateMipChain(const unsigned char* rgba, const int width, const int height, const bool srgb, const MipFilter filter)
+{
+	std::vector<MipLevel> chain;
+	if (width <= 0 || height <= 0)
+		return chain;
+	chain.reserve(MipLevelCount(width, height) - 1);
+
+	// every level is filtered from the float result of the previous one, so rounding doesn't add up down the chain
+	const ColorTables& tables = Tables();
+	std::vector<float> current(static_cast<size_t>(width) * height * 4);
+	for (size_t i = 0; i < current.size(); i++)
+	{
+		const bool color = i % 4 != 3;
+		current[i] = srgb && color ? tables.srgbToLinear[rgba[i]] : rgba[i] / 255.0f;
+	}
+
+	std::vector<float> next, scratch;
+	int levelWidth = width, levelHeight = height;
+	while (levelWidth > 1 || levelHeight > 1)
+	{
+		const int mipWidth = std::max(levelWidth / 2, 1), mipHeight = std::max(levelHeight / 2, 1);
+		next.resize(static_cast<size_t>(mipWidth) * mipHeight * 4);
+		if (filter == MipFilter::Box)
+			DownsampleBox(current.data(), levelWidth, levelHeight, next.data(), mipWidth, mipHeight);
+		else
+			DownsampleKaiser(current.data(), levelWidth, levelHeight, next.data(), mipWidth, mipHeight, scratch);
+
+		MipLevel level{ mipWidth, mipHeight, std::vector<unsigned char>(next.size()) };
+		for (size_t i = 0; i < next.size(); i++)
+			level.rgba[i] = EncodeChannel(next[i], srgb && i % 4 != 3);
+		chain.push_back(std::move(level));
+
+		current.swap(next);
+		levelWidth = mipWidth;
+		levelHeight = mipHeight;
+	}
+	return chain;
+}
+
+int MipLevelCount(int width, int height)
+{
+	int levels = 1;
+	while (width > 1 || height > 1)
+	{
+		width = std::max(width / 2, 1);
+		height = std::max(height / 2, 1);
+		levels++;
+	}
+	return levels;
+}
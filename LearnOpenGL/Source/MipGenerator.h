@@ -0,0 +1,24 @@
+#pragma once
+#include <vector>
+
+// CPU replacement for glGenerateMipmap, so mip chains can be built on worker threads, cooked to disk and uploaded
+// level by level without a driver stall at load.
+
+enum class MipFilter
+{
+	Box,   // 2x2 average, what drivers typically do
+	Kaiser // Kaiser windowed sinc over 6x6 texels, sharper and with less aliasing
+};
+
+struct MipLevel
+{
+	int width, height;
+	std::vector<unsigned char> rgba;
+};
+
+// Builds every level below an RGBA8 image down to 1x1, level 0 is the input itself and is not part of the result.
+// With srgb the color channels are decoded to linear light before filtering and encoded again afterwards, so the
+// mips keep the brightness of the base level. Alpha is always filtered as stored.
+std::vector<MipLevel> GenerateMipChain(const unsigned char* rgba, int width, int height, bool srgb, MipFilter filter = MipFilter::Kaiser);
+
+int MipLevelCount(int width, int height);
@@ -1,182 +1,566 @@
 ﻿#include "Model.h"
-#include "../Dependencies/stb_image.h"
+#include "MeshCache.h"
+#include "MeshImport.h"
+#include "MeshOptimizer.h"
+#include "MeshSimplifier.h"
+#include "FrameDataRing.h"
+#include "GLState.h"
+#include "Hash.h"
+#include "TextureCache.h"
+#include "TextureStreamer.h"
+#include "ThreadPool.h"
 
-void Model::Draw(Shader shader)
+#include <algorithm>
+#include <assimp/DefaultIOSystem.h>
+
+namespace
+{
+	// Reads files like the default IO system and remembers every one it opened besides the model itself, so the mesh
+	// cache can tell when a material library or another file the importer pulled in changes
+	class RecordingIOSystem : public Assimp::DefaultIOSystem
+	{
+	public:
+		RecordingIOSystem(std::string sourcePath, std::vector<std::string>& files) : sourcePath(std::move(sourcePath)), files(files) {}
+
+		Assimp::IOStream* Open(const char* file, const char* mode = "rb") override
+		{
+			Assimp::IOStream* stream = DefaultIOSystem::Open(file, mode);
+			if (stream && file != sourcePath && std::find(files.begin(), files.end(), file) == files.end())
+				files.push_back(file);
+			return stream;
+		}
+
+	private:
+		std::string sourcePath;
+		std::vector<std::string>& files;
+	};
+
+	// Room in geometry for every mesh in meshData. Indices are counted at 32 bits and aligned, so meshes that end up
+	// with 16 bit indices leave some of it unused.
+	template <typename Meshes>
+	void ReserveGeometry(GeometryBuffer& geometry, const Meshes& meshData)
+	{
+		const size_t vertexSize = geometry.GetFormat() == VertexFormat::Packed ? sizeof(PackedVertex) : sizeof(Vertex);
+		size_t vertexBytes = 0, indexBytes = 0;
+		for (const MeshData& data : meshData)
+		{
+			vertexBytes += data.vertices.size() * vertexSize;
+			indexBytes += data.indices.size() * sizeof(unsigned int) + 3;
+			for (const MeshLod& lod : data.lods)
+				indexBytes += lod.indices.size() * sizeof(unsigned int);
+		}
+		geometry.Reserve(vertexBytes, indexBytes);
+	}
+}
+
+Model::~Model()
+{
+	// outstanding decodes upload into the textures, so they have to land before the references are dropped
+	textureLoader.reset();
+	for (const Texture& texture : texturesLoaded)
+		TextureCache::Get().Release(texture.id);
+	if (instanceBuffer)
+		GLState::Get().DeleteBuffer(instanceBuffer);
+}
+
+void Model::Draw(const Shader& shader)
 {
+	if (geometry)
+	{
+		// every mesh lives in the same buffer, bind it once and only switch materials
+		geometry->Bind();
+		for (const Mesh& mesh : meshes)
+		{
+			mesh.BindMaterial(shader);
+			mesh.DrawRanges();
+		}
+		return;
+	}
+
 	for (unsigned int i = 0; i < meshes.size(); i++)
 	{
 		meshes[i].Draw(shader);
 	}
 }
 
-void Model::LoadModel(const std::string& path)
+size_t Model::Draw(const Shader& shader, const glm::mat4& transform, const LodView& view, ModelLodState& state)
 {
-	Assimp::Importer importer;
-	const aiScene* scene = importer.ReadFile(path, aiProcess_Triangulate | aiProcess_FlipUVs);
+	state.meshLods.resize(meshes.size(), 0);
+	if (CullMeshes(transform, view, state) == 0)
+		return 0;
 
-	if (!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode)
+	if (geometry)
+		geometry->Bind();
+	size_t triangles = 0;
+	int32_t boundNode = -2;
+	for (size_t i = 0; i < meshes.size(); i++)
 	{
-		std::cout << "ERROR::ASSIMP::" << importer.GetErrorString() << std::endl;
+		if (!state.meshVisible[i])
+			continue;
+		const Mesh& mesh = meshes[i];
+		const glm::mat4 meshTransform = transform * scene.GetMeshTransform(i);
+		// the meshes of a node are next to each other, so the transform only changes between nodes
+		if (scene.GetMeshNode(i) != boundNode)
+		{
+			FrameDataRing::Get().BindUniformBlock(OBJECT_BLOCK_BINDING, ObjectBlock{ meshTransform });
+			boundNode = scene.GetMeshNode(i);
+		}
+		const size_t lod = SelectLod(i, meshTransform, view, state);
+		if (geometry)
+		{
+			mesh.BindMaterial(shader);
+			mesh.DrawRanges(lod);
+		}
+		else
+		{
+			meshes[i].Draw(shader, lod);
+		}
+		triangles += mesh.TriangleCount(lod);
+	}
+	return triangles;
+}
+
+void Model::DrawInstanced(const Shader& shader, const glm::mat4* transforms, const size_t count, const size_t lod)
+{
+	if (count == 0)
 		return;
+
+	if (!instanceBuffer)
+		glGenBuffers(1, &instanceBuffer);
+	GLState& state = GLState::Get();
+	instanceCapacity = std::max(instanceCapacity, count);
+	// orphan the old storage so the driver doesn't wait for draws still reading the transforms written before
+	const auto upload = [&state, this, count](const glm::mat4* data)
+	{
+		state.BindBuffer(GL_ARRAY_BUFFER, instanceBuffer);
+		glBufferData(GL_ARRAY_BUFFER, instanceCapacity * sizeof(glm::mat4), nullptr, GL_STREAM_DRAW);
+		glBufferSubData(GL_ARRAY_BUFFER, 0, count * sizeof(glm::mat4), data);
+	};
+
+	// A geometry buffer shared with other models may have been pointed at their instance buffer since the last call,
+	// so it is set up every time. The VAOs this model owns only need it once.
+	const bool sharedGeometry = geometry && geometry != ownGeometry.get();
+	for (const Mesh& mesh : meshes)
+	{
+		const unsigned int vertexArray = mesh.GetVertexArray();
+		if (!sharedGeometry && std::find(instancedVertexArrays.begin(), instancedVertexArrays.end(), vertexArray) != instancedVertexArrays.end())
+			continue;
+		state.BindVertexArray(vertexArray);
+		SetupInstanceAttributes(instanceBuffer);
+		if (!sharedGeometry)
+			instancedVertexArrays.push_back(vertexArray);
+		if (geometry)
+			break;
 	}
-	directory = path.substr(0, path.find_last_of('/'));
 
-	ProcessNode(scene->mRootNode, scene);
+	if (geometry)
+		geometry->Bind();
+	// meshes of nodes with a transform of their own get the instance transforms moved by it, uploaded once per node
+	static const glm::mat4 IDENTITY(1.0f);
+	int32_t uploadedNode = -2;
+	for (size_t i = 0; i < meshes.size(); i++)
+	{
+		const Mesh& mesh = meshes[i];
+		const int32_t node = scene.GetMeshTransform(i) == IDENTITY ? -1 : scene.GetMeshNode(i);
+		if (node != uploadedNode)
+		{
+			if (node < 0)
+			{
+				upload(transforms);
+			}
+			else
+			{
+				nodeInstanceTransforms.resize(count);
+				for (size_t instance = 0; instance < count; instance++)
+					nodeInstanceTransforms[instance] = transforms[instance] * scene.GetNodeTransform(node);
+				upload(nodeInstanceTransforms.data());
+			}
+			uploadedNode = node;
+		}
+		if (!geometry)
+			state.BindVertexArray(mesh.GetVertexArray());
+		mesh.BindMaterial(shader);
+		mesh.DrawRangesInstanced(std::min(lod, mesh.LodCount() - 1), count);
+	}
 }
 
-void Model::ProcessNode(aiNode* node, const aiScene* scene)
+size_t Model::Submit(RenderQueue& queue, const Shader& shader, const glm::mat4& transform, const LodView& view, ModelLodState& state) const
 {
-	for (unsigned int i = 0; i < node->mNumMeshes; i++)
+	state.meshLods.resize(meshes.size(), 0);
+	CullMeshes(transform, view, state);
+
+	size_t triangles = 0;
+	for (size_t i = 0; i < meshes.size(); i++)
 	{
-		aiMesh* mesh = scene->mMeshes[node->mMeshes[i]];
-		meshes.push_back(ProcessMesh(mesh, scene));
+		if (!state.meshVisible[i])
+			continue;
+		const glm::mat4 meshTransform = transform * scene.GetMeshTransform(i);
+		const size_t lod = SelectLod(i, meshTransform, view, state);
+		queue.Submit(shader, meshes[i], lod, meshTransform);
+		triangles += meshes[i].TriangleCount(lod);
 	}
+	return triangles;
+}
 
-	for (unsigned int i = 0; i < node->mNumChildren; i++)
+size_t Model::Submit(IndirectDrawQueue& queue, const glm::mat4& transform, const LodView& view, ModelLodState& state) const
+{
+	state.meshLods.resize(meshes.size(), 0);
+	CullMeshes(transform, view, state);
+
+	size_t triangles = 0;
+	for (size_t i = 0; i < meshes.size(); i++)
 	{
-		ProcessNode(node->mChildren[i], scene);
+		if (!state.meshVisible[i])
+			continue;
+		const glm::mat4 meshTransform = transform * scene.GetMeshTransform(i);
+		const size_t lod = SelectLod(i, meshTransform, view, state);
+		queue.Submit(meshes[i], lod, meshTransform);
+		triangles += meshes[i].TriangleCount(lod);
 	}
+	return triangles;
 }
 
-Mesh Model::ProcessMesh(aiMesh* mesh, const aiScene* scene)
+float Model::MaxScale(const glm::mat4& transform)
 {
-	std::vector<Vertex> vertices;
-	std::vector<unsigned int> indices;
-	std::vector<Texture> textures;
+	// errors are scaled by the largest axis, exact for the usual uniform scale and conservative otherwise
+	return std::max({ glm::length(glm::vec3(transform[0])), glm::length(glm::vec3(transform[1])), glm::length(glm::vec3(transform[2])) });
+}
+
+size_t Model::CullMeshes(const glm::mat4& transform, const LodView& view, ModelLodState& state) const
+{
+	// the hierarchy is built once every mesh is in, until then an asynchronous load draws whatever it has
+	if (!view.frustum || !scene.IsBuilt())
+	{
+		state.meshVisible.assign(meshes.size(), 1);
+		return meshes.size();
+	}
+	// moving the frustum into the model leaves the bounds the hierarchy was built from as they are
+	state.meshVisible.resize(meshes.size());
+	return scene.Cull(TransformFrustum(*view.frustum, transform), state.meshVisible.data());
+}
+
+size_t Model::SelectLod(const size_t meshIndex, const glm::mat4& transform, const LodView& view, ModelLodState& state) const
+{
+	const Mesh& mesh = meshes[meshIndex];
+	const float scale = MaxScale(transform);
+	const glm::vec3 center(transform * glm::vec4(mesh.GetBoundsCenter(), 1.0f));
+	const float distance = std::max(glm::length(center - view.position) - mesh.GetBoundsRadius() * scale, 1e-3f);
+	const float pixelsPerUnit = view.pixelsPerUnit * scale / distance;
+
+	// coarsen only once the next level is comfortably under the limit, refine as soon as the current one is over it
+	size_t lod = std::min<size_t>(state.meshLods[meshIndex], mesh.LodCount() - 1);
+	while (lod + 1 < mesh.LodCount() && mesh.LodError(lod + 1) * pixelsPerUnit * (1.0f + view.hysteresis) <= view.pixelError)
+		lod++;
+	while (lod > 0 && mesh.LodError(lod) * pixelsPerUnit > view.pixelError)
+		lod--;
+	state.meshLods[meshIndex] = static_cast<unsigned char>(lod);
+
+	// without texture coordinates to go by the texture is assumed to wrap the bounds once
+	const float uvScale = mesh.GetUvScale() > 0.0f ? mesh.GetUvScale() : 2.0f * mesh.GetBoundsRadius();
+	for (const Texture& texture : mesh.textures)
+		TextureStreamer::Get().Request(texture.id, pixelsPerUnit * uvScale);
+	return lod;
+}
+
+std::vector<size_t> Model::GetLodTriangleCounts() const
+{
+	size_t levels = 0;
+	for (const Mesh& mesh : meshes)
+		levels = std::max(levels, mesh.LodCount());
+
+	std::vector<size_t> triangles(levels, 0);
+	for (const Mesh& mesh : meshes)
+	{
+		for (size_t lod = 0; lod < levels; lod++)
+			triangles[lod] += mesh.TriangleCount(std::min(lod, mesh.LodCount() - 1));
+	}
+	return triangles;
+}
+
+size_t Model::GetVertexBufferBytes() const
+{
+	size_t bytes = 0;
+	for (const Mesh& mesh : meshes)
+		bytes += mesh.VertexBufferBytes();
+	return bytes;
+}
+
+using Milliseconds = std::chrono::duration<double, std::milli>;
 
-	for (unsigned int i = 0; i < mesh->mNumVertices; i++)
+std::shared_ptr<Model> Model::LoadAsync(const std::string& path, const bool gamma, const ModelSettings& settings)
+{
+	std::shared_ptr<Model> model(new Model(gamma, settings));
+	model->BeginLoad(path);
+
+	// the worker only shares the pending state, so the model can be destroyed while it is still parsing
+	std::shared_ptr<PendingLoad> pending = std::make_shared<PendingLoad>();
+	model->pendingLoad = pending;
+	ThreadPool::Shared().Enqueue([pending, path, settings]
 	{
-		Vertex vertex;
-		glm::vec3 vector;
-		// vertex positions
-		vector.x = mesh->mVertices[i].x;
-		vector.y = mesh->mVertices[i].y;
-		vector.z = mesh->mVertices[i].z;
-		vertex.position = vector;
+		const auto start = std::chrono::steady_clock::now();
+		std::vector<MeshData> meshData;
+		std::vector<SceneNode> nodes;
+		bool cacheHit = false;
+		ReadMeshData(path, settings, meshData, nodes, cacheHit);
 
-		// normal positions
-		vector.x = mesh->mNormals[i].x;
-		vector.y = mesh->mNormals[i].y;
-		vector.z = mesh->mNormals[i].z;
-		vertex.normal = vector;
+		std::lock_guard<std::mutex> lock(pending->mutex);
+		for (MeshData& data : meshData)
+			pending->meshes.push_back(std::move(data));
+		pending->nodes = std::move(nodes);
+		pending->parsed = true;
+		pending->cacheHit = cacheHit;
+		pending->geometryMs = Milliseconds(std::chrono::steady_clock::now() - start).count();
+	});
+	return model;
+}
+
+bool Model::Update(const size_t maxMeshUploads, const size_t maxTextureUploads)
+{
+	if (pendingLoad)
+	{
+		std::vector<MeshData> ready;
+		bool parsed;
+		{
+			std::lock_guard<std::mutex> lock(pendingLoad->mutex);
+			// the hierarchy arrives together with the meshes, so every mesh has its transform from its first draw
+			if (pendingLoad->parsed && !pendingLoad->nodes.empty())
+			{
+				scene.SetNodes(std::move(pendingLoad->nodes), meshes.size() + pendingLoad->meshes.size());
+				pendingLoad->nodes.clear();
+			}
+			// every mesh is parsed before the first one is handed over, so the buffers get their final size once
+			// instead of growing while earlier meshes are drawn from them. The mesh vector is sized once as well, queues
+			// hold pointers to the meshes and may still do so when Update adds more.
+			if (pendingLoad->parsed && !pendingLoad->reserved)
+			{
+				meshes.reserve(meshes.size() + pendingLoad->meshes.size());
+				meshBounds.reserve(meshBounds.size() + pendingLoad->meshes.size());
+				if (geometry)
+					ReserveGeometry(*geometry, pendingLoad->meshes);
+				pendingLoad->reserved = true;
+			}
+			while (ready.size() < maxMeshUploads && !pendingLoad->meshes.empty())
+			{
+				ready.push_back(std::move(pendingLoad->meshes.front()));
+				pendingLoad->meshes.pop_front();
+			}
+			parsed = pendingLoad->parsed && pendingLoad->meshes.empty();
+			loadStats.cacheHit = pendingLoad->cacheHit;
+			loadStats.geometryMs = pendingLoad->geometryMs;
+		}
 
-		// texture coordinates
-		if (mesh->mTextureCoords[0])
+		for (MeshData& data : ready)
+			AddMesh(data);
+		if (geometry && !ready.empty())
+			geometry->Upload();
+		if (parsed)
 		{
-			glm::vec2 vec;
-			vec.x = mesh->mTextureCoords[0][i].x;
-			vec.y = mesh->mTextureCoords[0][i].y;
-			vertex.texCoords = vec;
+			scene.Build(meshBounds.data(), meshBounds.size());
+			pendingLoad.reset();
 		}
-		else
-			vertex.texCoords = glm::vec2(0.0f, 0.0f);
+	}
+
+	if (textureLoader)
+	{
+		textureLoader->Poll(maxTextureUploads);
+		if (!pendingLoad && textureLoader->Idle())
+			FinishLoad();
+	}
+	return IsLoaded();
+}
 
-		//// tangent
-		//vector.x = mesh->mTangents[i].x;
-		//vector.y = mesh->mTangents[i].y;
-		//vector.z = mesh->mTangents[i].z;
-		//vertex.tangent = vector;
+void Model::LoadModel(const std::string& path)
+{
+	BeginLoad(path);
 
-		//// bitangent
-		//vector.x = mesh->mBitangents[i].x;
-		//vector.y = mesh->mBitangents[i].y;
-		//vector.z = mesh->mBitangents[i].z;
-		//vertex.bitangent = vector;
+	// the cache is keyed by the source contents and the import settings, Assimp only runs when it is stale
+	std::vector<MeshData> meshData;
+	std::vector<SceneNode> nodes;
+	if (ReadMeshData(path, settings, meshData, nodes, loadStats.cacheHit))
+	{
+		loadStats.geometryMs = Milliseconds(std::chrono::steady_clock::now() - loadStart).count();
+		scene.SetNodes(std::move(nodes), meshData.size());
 
-		vertices.push_back(vertex);
+		// texture names are reserved up front so meshes can be built while the images decode on the worker pool
+		meshes.reserve(meshData.size());
+		if (geometry)
+			ReserveGeometry(*geometry, meshData);
+		for (MeshData& data : meshData)
+			AddMesh(data);
+		if (geometry)
+			geometry->Upload();
+		scene.Build(meshBounds.data(), meshBounds.size());
 	}
 
-	// process indices
-	for (unsigned int i = 0; i < mesh->mNumFaces; i++)
+	textureLoader->Finish();
+	FinishLoad();
+}
+
+void Model::BeginLoad(const std::string& path)
+{
+	loadStart = std::chrono::steady_clock::now();
+	directory = path.substr(0, path.find_last_of('/'));
+	textureLoader.reset(new TextureLoader(ThreadPool::Shared(), true, settings.streamTextures));
+
+	if (settings.packGeometry)
 	{
-		aiFace face = mesh->mFaces[i];
-		for (unsigned int j = 0; j < face.mNumIndices; j++)
-			indices.push_back(face.mIndices[j]);
+		geometry = settings.geometry;
+		if (!geometry)
+		{
+			ownGeometry.reset(new GeometryBuffer(settings.vertexFormat));
+			geometry = ownGeometry.get();
+		}
 	}
+}
 
-	// process materials
-	aiMaterial* material = scene->mMaterials[mesh->mMaterialIndex]
-		;
-	std::vector<Texture> diffuseMaps = LoadMaterialTextures(material, aiTextureType_DIFFUSE, "texture_diffuse");
-	textures.insert(textures.end(), diffuseMaps.begin(), diffuseMaps.end());
+void Model::AddMesh(MeshData& data)
+{
+	std::vector<Texture> textures;
+	textures.reserve(data.textures.size());
+	for (const TextureRef& ref : data.textures)
+		textures.push_back(LoadTexture(ref, *textureLoader));
 
-	std::vector<Texture> specularMaps = LoadMaterialTextures(material, aiTextureType_SPECULAR, "texture_specular");
-	textures.insert(textures.end(), specularMaps.begin(), specularMaps.end());
+	const VertexFormat format = geometry ? geometry->GetFormat() : settings.vertexFormat;
+	meshes.emplace_back(std::move(data.vertices), std::move(data.indices), std::move(textures), format, geometry, std::move(data.lods));
+	const Mesh& mesh = meshes.back();
+	meshBounds.push_back(CullBounds{ mesh.GetBoundsCenter(), mesh.GetBoundsRadius(), mesh.GetBoundsExtents(), 0.0f });
+	loadStats.indexBytes32 += meshes.back().IndexCount() * sizeof(unsigned int);
+	loadStats.indexBytes += meshes.back().IndexBufferBytes();
+}
 
-	std::vector<Texture> normalMaps = LoadMaterialTextures(material, aiTextureType_HEIGHT, "texture_normal");
-	textures.insert(textures.end(), normalMaps.begin(), normalMaps.end());
+void Model::FinishLoad()
+{
+	textureLoader.reset();
+	loadStats.totalMs = Milliseconds(std::chrono::steady_clock::now() - loadStart).count();
+	loadStats.textureMs = loadStats.totalMs - loadStats.geometryMs;
+}
 
-	std::vector<Texture> heightMaps = LoadMaterialTextures(material, aiTextureType_AMBIENT, "texture_height");
-	textures.insert(textures.end(), heightMaps.begin(), heightMaps.end());
+bool Model::ReadMeshData(const std::string& path, const ModelSettings& settings, std::vector<MeshData>& meshData, std::vector<SceneNode>& nodes,
+	bool& cacheHit)
+{
+	const uint64_t sourceHash = MeshCache::HashSource(path);
+	const uint32_t importKey = ImportKey(settings);
+	cacheHit = MeshCache::Load(path, sourceHash, importKey, meshData, nodes);
+	if (cacheHit)
+		return true;
 
-	return Mesh(vertices, indices, textures);
+	std::vector<std::string> dependencies;
+	if (!ImportModel(path, settings, meshData, nodes, dependencies))
+		return false;
+	MeshCache::Store(path, sourceHash, importKey, dependencies, meshData, nodes);
+	return true;
 }
 
-std::vector<Texture> Model::LoadMaterialTextures(aiMaterial* mat, aiTextureType type, std::string typeName)
+uint32_t Model::ImportKey(const ModelSettings& settings)
 {
-	std::vector<Texture> textures;
-	for (unsigned int i = 0; i < mat->GetTextureCount(type); i++)
+	const uint32_t key[] = { IMPORT_FLAGS, settings.optimizeMeshes };
+	const uint64_t hash = HashBytes(key, sizeof(key));
+	return static_cast<uint32_t>(HashBytes(settings.lodErrors.data(), settings.lodErrors.size() * sizeof(float), hash));
+}
+
+bool Model::ImportModel(const std::string& path, const ModelSettings& settings, std::vector<MeshData>& meshData, std::vector<SceneNode>& nodes,
+	std::vector<std::string>& dependencies)
+{
+	Assimp::Importer importer;
+	// the importer owns and deletes the IO system
+	importer.SetIOHandler(new RecordingIOSystem(path, dependencies));
+	const aiScene* scene = importer.ReadFile(path, IMPORT_FLAGS);
+
+	if (!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode)
 	{
-		aiString str;
-		mat->GetTexture(type, i, &str);
-		bool skip = false;
-		for (unsigned int j = 0; j < texturesLoaded.size(); j++)
+		std::cout << "ERROR::ASSIMP::" << importer.GetErrorString() << std::endl;
+		return false;
+	}
+
+	meshData.reserve(scene->mNumMeshes);
+	ProcessNode(scene->mRootNode, scene, -1, meshData, nodes);
+
+	if (settings.optimizeMeshes)
+	{
+		for (size_t i = 0; i < meshData.size(); i++)
 		{
-			if (std::strcmp(texturesLoaded[j].path.data(), str.C_Str()) == 0)
-			{
-				textures.push_back(texturesLoaded[j]);
-				skip = true;
-				break;
-			}
+			const MeshOptimizeReport report = OptimizeMesh(meshData[i]);
+			std::cout << "MODEL::OPTIMIZE::MESH " << i << " ACMR " << report.before.acmr << " -> " << report.after.acmr
+				<< ", ATVR " << report.before.atvr << " -> " << report.after.atvr << std::endl;
 		}
-		if (!skip)
+	}
+
+	if (!settings.lodErrors.empty())
+	{
+		for (size_t i = 0; i < meshData.size(); i++)
 		{
-			Texture texture;
-			texture.id = TextureFromFile(str.C_Str(), this->directory);
-			texture.type = typeName;
-			texture.path = str.C_Str();
-			textures.push_back(texture);
-			texturesLoaded.push_back(texture);
+			GenerateLods(meshData[i], settings.lodErrors, settings.optimizeMeshes);
+			std::cout << "MODEL::LOD::MESH " << i << " triangles " << meshData[i].indices.size() / 3;
+			for (const MeshLod& lod : meshData[i].lods)
+				std::cout << " -> " << lod.indices.size() / 3 << " (error " << lod.error << ")";
+			std::cout << std::endl;
 		}
 	}
-	return textures;
+	return true;
 }
 
-unsigned Model::TextureFromFile(const char* path, const std::string& dictionary, bool gamma) const
+void Model::ProcessNode(aiNode* node, const aiScene* scene, const int32_t parent, std::vector<MeshData>& meshData, std::vector<SceneNode>& nodes)
 {
-	std::string filename = std::string(path);
-	filename = directory + '/' + filename;
+	// Assimp matrices are row major, glm's column major
+	const aiMatrix4x4& m = node->mTransformation;
+	SceneNode sceneNode;
+	sceneNode.transform = glm::mat4(m.a1, m.b1, m.c1, m.d1, m.a2, m.b2, m.c2, m.d2, m.a3, m.b3, m.c3, m.d3, m.a4, m.b4, m.c4, m.d4);
+	sceneNode.parent = parent;
+	sceneNode.firstMesh = static_cast<uint32_t>(meshData.size());
+	sceneNode.meshCount = node->mNumMeshes;
+	const auto index = static_cast<int32_t>(nodes.size());
+	nodes.push_back(sceneNode);
 
-	unsigned int textureID;
-	glGenTextures(1, &textureID);
+	for (unsigned int i = 0; i < node->mNumMeshes; i++)
+	{
+		aiMesh* mesh = scene->mMeshes[node->mMeshes[i]];
+		meshData.push_back(ProcessMesh(mesh, scene));
+	}
 
-	int width, height, numComponents;
-	unsigned char* data = stbi_load(filename.c_str(), &width, &height, &numComponents, 0);
-	if (data)
+	for (unsigned int i = 0; i < node->mNumChildren; i++)
 	{
-		GLenum format;
-		if (numComponents == 1)
-			format = GL_RED;
-		else if (numComponents == 3)
-			format = GL_RGB;
-		else if (numComponents == 4)
-			format = GL_RGBA;
+		ProcessNode(node->mChildren[i], scene, index, meshData, nodes);
+	}
+}
 
-		glBindTexture(GL_TEXTURE_2D, textureID);
-		glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
-		glGenerateMipmap(GL_TEXTURE_2D);
+MeshData Model::ProcessMesh(aiMesh* mesh, const aiScene* scene)
+{
+	MeshData data;
+	ImportVertices(*mesh, data.vertices);
+	ImportIndices(*mesh, data.indices);
 
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	// process materials
+	aiMaterial* material = scene->mMaterials[mesh->mMaterialIndex];
+	LoadMaterialTextures(material, aiTextureType_DIFFUSE, "texture_diffuse", data.textures);
+	LoadMaterialTextures(material, aiTextureType_SPECULAR, "texture_specular", data.textures);
+	LoadMaterialTextures(material, aiTextureType_HEIGHT, "texture_normal", data.textures);
+	LoadMaterialTextures(material, aiTextureType_AMBIENT, "texture_height", data.textures);
 
-		stbi_image_free(data);
-	}
-	else
+	return data;
+}
+
+void Model::LoadMaterialTextures(aiMaterial* mat, const aiTextureType type, const std::string& typeName, std::vector<TextureRef>& textures)
+{
+	for (unsigned int i = 0; i < mat->GetTextureCount(type); i++)
 	{
-		std::cout << "Texture failed to load at path: " << path << std::endl;
-		stbi_image_free(data);
+		aiString str;
+		mat->GetTexture(type, i, &str);
+		textures.push_back({ typeName, str.C_Str() });
 	}
-	return textureID;
+}
+
+bool Model::IsSrgbTexture(const std::string& type, const bool gamma)
+{
+	return gamma && type == "texture_diffuse";
+}
+
+Texture Model::LoadTexture(const TextureRef& ref, TextureLoader& loader)
+{
+	// repeated and shared files resolve to the same texture through the process-wide cache
+	Texture texture;
+	texture.id = TextureCache::Get().Acquire(directory + '/' + ref.path, loader, IsSrgbTexture(ref.type, gammaCorrection));
+	texture.type = ref.type;
+	texture.path = ref.path;
+	texturesLoaded.push_back(texture);
+	return texture;
 }
@@ -1,28 +1,185 @@
 ﻿#pragma once
 #include "Mesh.h"
+#include "Frustum.h"
+#include "SceneGraph.h"
+#include "TextureLoader.h"
+#include "GeometryBuffer.h"
+#include "RenderQueue.h"
+#include "IndirectDrawQueue.h"
 #include <assimp/Importer.hpp>
 #include <assimp/scene.h>
 #include <assimp/postprocess.h>
+#include <chrono>
+#include <cmath>
+#include <deque>
+#include <memory>
+#include <mutex>
+
+// Optional import stages. Everything here that changes the imported geometry is part of the mesh cache key.
+struct ModelSettings
+{
+	bool optimizeMeshes = false; // reorder for the vertex cache, overdraw and vertex fetch
+	VertexFormat vertexFormat = VertexFormat::Full; // GPU layout only, the cached data is always full precision
+	// Pack all meshes into one vertex and index buffer with a single VAO. If geometry is set the meshes go into that
+	// buffer, which lets a whole scene share it, otherwise the model creates its own. Its format overrides vertexFormat.
+	bool packGeometry = false;
+	GeometryBuffer* geometry = nullptr;
+	// One simplified level of detail per entry, each the largest error it may introduce relative to the mesh size,
+	// for example { 0.002f, 0.01f, 0.04f }. Empty keeps only the full resolution meshes.
+	std::vector<float> lodErrors;
+	// Keep only the small mip levels resident at first and let TextureStreamer bring in finer ones as the LodView
+	// overload of Draw asks for them. Call TextureStreamer::Get().Update() once per frame. A texture shared with an
+	// already loaded model keeps the residency it was loaded with.
+	bool streamTextures = false;
+};
+
+// What level of detail selection needs to know about the camera
+struct LodView
+{
+	LodView(const glm::vec3& position, const float fovY, const float viewportHeight, const float pixelError = 1.0f, const float hysteresis = 0.25f)
+		: position(position), pixelsPerUnit(viewportHeight / (2.0f * std::tan(fovY * 0.5f))), pixelError(pixelError), hysteresis(hysteresis) {}
+
+	glm::vec3 position;
+	float pixelsPerUnit; // size in pixels of one world unit at distance one
+	float pixelError;    // largest simplification error allowed on screen, in pixels
+	float hysteresis;    // a coarser level is only picked once its error is this fraction below the limit, so levels don't flicker
+	const Frustum* frustum = nullptr; // meshes whose bounds are outside are skipped, nullptr draws every mesh
+};
+
+// Level of detail picked for every mesh of one drawn instance, kept between frames for the hysteresis
+struct ModelLodState
+{
+	std::vector<unsigned char> meshLods;
+	std::vector<unsigned char> meshVisible; // result of the last culling pass
+};
+
+struct ModelLoadStats
+{
+	bool cacheHit = false;
+	double geometryMs = 0.0; // Assimp import, or reading the mesh cache on a hit
+	double textureMs = 0.0;
+	double totalMs = 0.0;
+	size_t indexBytes32 = 0; // index memory if every mesh used 32-bit indices
+	size_t indexBytes = 0;   // index memory actually uploaded
+};
 
 class Model
 {
 public:
+	static const unsigned int IMPORT_FLAGS = aiProcess_Triangulate | aiProcess_FlipUVs | aiProcess_CalcTangentSpace;
 
-	Model(const std::string& path, const bool gamma = false) : gammaCorrection(gamma)
+	// Blocks until every mesh and texture is loaded
+	Model(const std::string& path, const bool gamma = false, const ModelSettings& settings = ModelSettings())
+		: gammaCorrection(gamma), settings(settings)
 	{
 		LoadModel(path);
 	}
-	void Draw(Shader shader);
+	~Model();
+
+	// Returns right away while parsing and texture decoding run on the worker pool. Call Update once per frame on
+	// the GL thread to upload whatever has finished, until then Draw skips missing meshes and textures show a placeholder.
+	static std::shared_ptr<Model> LoadAsync(const std::string& path, bool gamma = false, const ModelSettings& settings = ModelSettings());
+
+	// Whether a texture of the given type is sampled as sRGB, with gamma correction diffuse maps are and the other maps
+	// hold linear data. Cooked textures have to be cooked the same way to be used.
+	static bool IsSrgbTexture(const std::string& type, bool gamma);
+
+	// Uploads at most the given number of meshes and textures, returns true once the model is fully loaded
+	bool Update(size_t maxMeshUploads = 4, size_t maxTextureUploads = 2);
+	bool IsLoaded() const { return !pendingLoad && !textureLoader; }
+
+	// the model holds references on shared textures, see TextureCache
+	Model(const Model&) = delete;
+	Model& operator=(const Model&) = delete;
+
+	// draws with the model matrix the caller bound, the node transforms of the scene graph aren't applied
+	void Draw(const Shader& shader);
+	// Sets the model matrix of every node and draws every mesh inside view.frustum at the coarsest level whose projected
+	// error stays within view.pixelError. Culling walks the scene graph's hierarchy, so whole groups of meshes outside
+	// the frustum cost one test. Each drawn instance needs its own state. Returns the number of triangles submitted.
+	// Streamed textures are asked for at the resolution the meshes cover on screen, culled meshes don't ask.
+	size_t Draw(const Shader& shader, const glm::mat4& transform, const LodView& view, ModelLodState& state);
+	// Draws every mesh once per transform with one instanced draw per index range, all at the same level of detail.
+	// The transforms are streamed into an instance buffer read by attributes 4 to 7, so the shader has to take its model
+	// matrix from there (see ModelShaderInstanced.vert). Meshes of nodes with a transform of their own get the transforms
+	// moved by it, which takes another upload per such node.
+	void DrawInstanced(const Shader& shader, const glm::mat4* transforms, size_t count, size_t lod = 0);
+	void DrawInstanced(const Shader& shader, const std::vector<glm::mat4>& transforms, const size_t lod = 0)
+	{
+		DrawInstanced(shader, transforms.data(), transforms.size(), lod);
+	}
+	// Same culling and level of detail selection as Draw, but the meshes go into the queue to be sorted with the rest of the frame.
+	// The model has to outlive the queue's Execute.
+	size_t Submit(RenderQueue& queue, const Shader& shader, const glm::mat4& transform, const LodView& view, ModelLodState& state) const;
+	size_t Submit(IndirectDrawQueue& queue, const glm::mat4& transform, const LodView& view, ModelLodState& state) const;
+	// triangles of all meshes summed per level of detail, meshes with fewer levels count with their coarsest one
+	std::vector<size_t> GetLodTriangleCounts() const;
+	const ModelLoadStats& GetLoadStats() const { return loadStats; }
+	// one entry per material texture reference, shared files appear once per reference
+	const std::vector<Texture>& GetLoadedTextures() const { return texturesLoaded; }
+	const std::string& GetDirectory() const { return directory; }
+	// The imported node hierarchy. Nodes can be moved through SetLocalTransform, call Update on it before drawing.
+	SceneGraph& GetSceneGraph() { return scene; }
+	const SceneGraph& GetSceneGraph() const { return scene; }
+	size_t GetVertexBufferBytes() const;
 private:
+	// sized for every mesh before the first is added, so the pointers render queues hold stay valid while Update adds more
 	std::vector<Mesh> meshes;
+	std::vector<CullBounds> meshBounds; // one per mesh, in the space of the mesh
+	SceneGraph scene;
 	std::string directory;
 	std::vector<Texture> texturesLoaded;
 	bool gammaCorrection;
+	ModelSettings settings;
+	ModelLoadStats loadStats;
+	std::unique_ptr<GeometryBuffer> ownGeometry;
+	GeometryBuffer* geometry = nullptr;
+	// per instance transforms for DrawInstanced, created on first use
+	unsigned int instanceBuffer = 0;
+	size_t instanceCapacity = 0;
+	std::vector<unsigned int> instancedVertexArrays;
+	std::vector<glm::mat4> nodeInstanceTransforms;
+
+	// Parse results handed from the worker pool to the GL thread while an asynchronous load is running
+	struct PendingLoad
+	{
+		std::mutex mutex;
+		std::deque<MeshData> meshes;
+		std::vector<SceneNode> nodes;
+		bool parsed = false;
+		bool reserved = false; // the geometry buffer has room for every parsed mesh
+		bool cacheHit = false;
+		double geometryMs = 0.0;
+	};
+	std::shared_ptr<PendingLoad> pendingLoad;
+	std::unique_ptr<TextureLoader> textureLoader;
+	std::chrono::steady_clock::time_point loadStart;
+
+	Model(const bool gamma, const ModelSettings& settings) : gammaCorrection(gamma), settings(settings) {}
 
 	void LoadModel(const std::string& path);
-	void ProcessNode(aiNode* node, const aiScene* scene);
-	Mesh ProcessMesh(aiMesh* mesh, const aiScene* scene);
-	std::vector<Texture> LoadMaterialTextures(aiMaterial* mat, aiTextureType type, std::string typeName);
-	unsigned int TextureFromFile(const char* path, const std::string& dictionary, bool gamma = false) const;
+	void BeginLoad(const std::string& path);
+	void AddMesh(MeshData& data);
+	void FinishLoad();
+
+	// CPU side of loading, safe to run on any thread
+	static bool ReadMeshData(const std::string& path, const ModelSettings& settings, std::vector<MeshData>& meshData, std::vector<SceneNode>& nodes,
+		bool& cacheHit);
+	static uint32_t ImportKey(const ModelSettings& settings);
+	// dependencies receives every file other than path that Assimp read
+	static bool ImportModel(const std::string& path, const ModelSettings& settings, std::vector<MeshData>& meshData, std::vector<SceneNode>& nodes,
+		std::vector<std::string>& dependencies);
+	// appends the node to nodes and its meshes to meshData, then does the same for its children
+	static void ProcessNode(aiNode* node, const aiScene* scene, int32_t parent, std::vector<MeshData>& meshData, std::vector<SceneNode>& nodes);
+	static MeshData ProcessMesh(aiMesh* mesh, const aiScene* scene);
+	static void LoadMaterialTextures(aiMaterial* mat, aiTextureType type, const std::string& typeName, std::vector<TextureRef>& textures);
+
+	Texture LoadTexture(const TextureRef& ref, TextureLoader& loader);
+
+	static float MaxScale(const glm::mat4& transform);
+	// fills state.meshVisible, returns the number of visible meshes
+	size_t CullMeshes(const glm::mat4& transform, const LodView& view, ModelLodState& state) const;
+	// picks the level of detail of one mesh placed by transform for this view and asks for its textures at the matching resolution
+	size_t SelectLod(size_t meshIndex, const glm::mat4& transform, const LodView& view, ModelLodState& state) const;
 
 };
@@ -0,0 +1,139 @@
+#include "RenderQueue.h"
+#include "FrameDataRing.h"
+#include "GLState.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <numeric>
+
+namespace
+{
+	// Key layout, most significant bit first:
+	//   opaque:      0 | program 11 | vertex array 8 | material 16 | depth 24 | 4 unused
+	//   transparent: 1 | inverted depth 24 | program 11 | vertex array 8 | material 16 | 4 unused
+	// Ids that don't fit their field wrap around, which only costs sorting quality.
+	const uint64_t PROGRAM_MASK = 0x7FF;
+	const uint64_t VERTEX_ARRAY_MASK = 0xFF;
+	const uint64_t MATERIAL_MASK = 0xFFFF;
+	const uint64_t DEPTH_MASK = 0xFFFFFF;
+	const uint64_t TRANSPARENT_BIT = 1ull << 63;
+
+	template <typename Key>
+	uint64_t IdFor(std::unordered_map<Key, uint32_t>& ids, const Key value)
+	{
+		return ids.emplace(value, static_cast<uint32_t>(ids.size())).first->second;
+	}
+
+	// the bits of a non-negative float order the same way as its value, the top 24 keep a 15 bit mantissa
+	uint64_t DepthBits(const float distance)
+	{
+		uint32_t bits;
+		std::memcpy(&bits, &distance, sizeof(bits));
+		return bits >> 8;
+	}
+}
+
+void RenderQueue::Begin(const glm::vec3& viewPosition)
+{
+	this->viewPosition = viewPosition;
+	commands.clear();
+	keys.clear();
+	stats = RenderQueueStats();
+}
+
+void RenderQueue::Submit(const Shader& shader, const Mesh& mesh, const size_t lod, const glm::mat4& transform, const bool transparent)
+{
+	const glm::vec3 center(transform * glm::vec4(mesh.GetBoundsCenter(), 1.0f));
+	const uint64_t depth = DepthBits(std::max(glm::length(center - viewPosition), 0.0f));
+	const uint64_t program = IdFor(programIds, shader.id) & PROGRAM_MASK;
+	const uint64_t vertexArray = IdFor(vertexArrayIds, mesh.GetVertexArray()) & VERTEX_ARRAY_MASK;
+	const uint64_t material = IdFor(materialIds, mesh.GetMaterialKey()) & MATERIAL_MASK;
+
+	if (transparent)
+		keys.push_back(TRANSPARENT_BIT | (~depth & DEPTH_MASK) << 39 | program << 28 | vertexArray << 20 | material << 4);
+	else
+		keys.push_back(program << 52 | vertexArray << 44 | material << 28 | depth << 4);
+	commands.push_back({ &shader, &mesh, lod, transform });
+}
+
+void RenderQueue::Execute()
+{
+	const auto start = std::chrono::steady_clock::now();
+	RadixSort();
+	stats.sortMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+	// GLState drops the binds that wouldn't change anything, the order makes sure there are many of those
+	GLState& state = GLState::Get();
+	FrameDataRing& frameData = FrameDataRing::Get();
+	bool blending = false;
+
+	for (const uint32_t index : order)
+	{
+		const Command& command = commands[index];
+		if (!blending && (keys[index] & TRANSPARENT_BIT))
+		{
+			state.SetEnabled(GL_BLEND, true);
+			state.BlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+			state.DepthMask(false);
+			blending = true;
+		}
+
+		if (state.UseProgram(command.shader->id))
+			stats.programBinds++;
+		if (state.BindVertexArray(command.mesh->GetVertexArray()))
+			stats.vertexArrayBinds++;
+		for (const TextureBinding& binding : command.mesh->GetMaterial())
+		{
+			if (state.BindTexture(binding.unit, binding.textureId))
+				stats.textureBinds++;
+			else
+				stats.skippedTextureBinds++;
+		}
+
+		frameData.BindUniformBlock(OBJECT_BLOCK_BINDING, ObjectBlock{ command.transform });
+		command.mesh->SetFormatUniforms(*command.shader);
+		command.mesh->DrawRanges(command.lod);
+		stats.draws++;
+	}
+
+	if (blending)
+	{
+		state.SetEnabled(GL_BLEND, false);
+		state.DepthMask(true);
+	}
+}
+
+void RenderQueue::RadixSort()
+{
+	const size_t count = keys.size();
+	order.resize(count);
+	scratch.resize(count);
+	std::iota(order.begin(), order.end(), 0u);
+
+	// one pass over the keys builds the histograms of all eight bytes
+	size_t histograms[8][256] = {};
+	for (const uint64_t key : keys)
+	{
+		for (int byte = 0; byte < 8; byte++)
+			histograms[byte][(key >> (byte * 8)) & 0xFF]++;
+	}
+
+	for (int byte = 0; byte < 8; byte++)
+	{
+		size_t* histogram = histograms[byte];
+		if (std::find(histogram, histogram + 256, count) != histogram + 256)
+			continue;
+
+		size_t offset = 0;
+		for (int bucket = 0; bucket < 256; bucket++)
+		{
+			const size_t bucketSize = histogram[bucket];
+			histogram[bucket] = offset;
+			offset += bucketSize;
+		}
+		for (const uint32_t index : order)
+			scratch[histogram[(keys[index] >> (byte * 8)) & 0xFF]++] = index;
+		order.swap(scratch);
+	}
+}
@@ -0,0 +1,56 @@
+#pragma once
+#include "Mesh.h"
+#include "Shader.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <glm/glm.hpp>
+#include <unordered_map>
+#include <vector>
+
+struct RenderQueueStats
+{
+	size_t draws = 0;
+	size_t programBinds = 0;
+	size_t vertexArrayBinds = 0;
+	size_t textureBinds = 0;
+	size_t skippedTextureBinds = 0; // texture already bound to its unit by an earlier draw
+	double sortMs = 0.0;
+};
+
+// Collects the draws of a frame, orders them by a 64-bit key and submits them with as few state changes as possible.
+// Opaque draws sort by program, vertex array, material and then front to back, transparent ones after them from back
+// to front. Submit between Begin and Execute, the queue keeps its memory between frames.
+class RenderQueue
+{
+public:
+	void Begin(const glm::vec3& viewPosition);
+	void Submit(const Shader& shader, const Mesh& mesh, size_t lod, const glm::mat4& transform, bool transparent = false);
+	// Sorts and draws everything submitted since Begin. Transparent draws are blended without depth writes.
+	void Execute();
+
+	size_t Size() const { return commands.size(); }
+	const RenderQueueStats& GetStats() const { return stats; }
+
+private:
+	struct Command
+	{
+		const Shader* shader;
+		const Mesh* mesh;
+		size_t lod;
+		glm::mat4 transform;
+	};
+
+	glm::vec3 viewPosition{ 0.0f };
+	std::vector<Command> commands;
+	std::vector<uint64_t> keys;
+	std::vector<uint32_t> order, scratch;
+	// small stable ids for the key fields, handed out as programs, VAOs and materials are first seen
+	std::unordered_map<unsigned int, uint32_t> programIds;
+	std::unordered_map<unsigned int, uint32_t> vertexArrayIds;
+	std::unordered_map<uint64_t, uint32_t> materialIds;
+	RenderQueueStats stats;
+
+	// sorts order by keys, least significant byte first, skipping bytes every key shares
+	void RadixSort();
+};
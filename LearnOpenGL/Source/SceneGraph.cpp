@@ -0,0 +1,87 @@
+#include "SceneGraph.h"
+
+#include <iostream>
+
+void SceneGraph::SetNodes(std::vector<SceneNode> sceneNodes, const size_t meshCount)
+{
+	nodes = std::move(sceneNodes);
+	meshNodes.assign(meshCount, -1);
+	for (size_t i = 0; i < nodes.size(); i++)
+	{
+		SceneNode& node = nodes[i];
+		// transforms are computed parents first, a parent that doesn't come before its child would be read unset
+		if (node.parent >= static_cast<int32_t>(i))
+		{
+			std::cout << "ERROR::SCENEGRAPH::NODE " << i << " COMES BEFORE ITS PARENT" << std::endl;
+			node.parent = -1;
+		}
+		for (size_t mesh = node.firstMesh; mesh < node.firstMesh + node.meshCount && mesh < meshCount; mesh++)
+			meshNodes[mesh] = static_cast<int32_t>(i);
+	}
+	UpdateTransforms();
+	built = false;
+	moved = false;
+}
+
+void SceneGraph::Build(const CullBounds* meshBounds, const size_t count)
+{
+	localBounds.assign(meshBounds, meshBounds + count);
+	meshNodes.resize(count, -1);
+	UpdateBounds();
+	hierarchy.Build(bounds.data(), bounds.size());
+	built = true;
+}
+
+int32_t SceneGraph::GetMeshNode(const size_t mesh) const
+{
+	return mesh < meshNodes.size() ? meshNodes[mesh] : -1;
+}
+
+const glm::mat4& SceneGraph::GetMeshTransform(const size_t mesh) const
+{
+	static const glm::mat4 IDENTITY(1.0f);
+	const int32_t node = GetMeshNode(mesh);
+	return node < 0 ? IDENTITY : nodeTransforms[node];
+}
+
+void SceneGraph::SetLocalTransform(const size_t node, const glm::mat4& transform)
+{
+	nodes[node].transform = transform;
+	moved = true;
+}
+
+void SceneGraph::Update()
+{
+	if (!moved)
+		return;
+	// every transform is one multiply away from its parent's, redoing all of them is cheaper than finding the subtrees
+	UpdateTransforms();
+	if (built)
+	{
+		UpdateBounds();
+		hierarchy.Refit(bounds.data());
+	}
+	moved = false;
+}
+
+size_t SceneGraph::Cull(const Frustum& frustum, unsigned char* visible) const
+{
+	return FrustumCuller::Get().Cull(frustum, hierarchy, bounds.data(), bounds.size(), visible);
+}
+
+void SceneGraph::UpdateTransforms()
+{
+	nodeTransforms.resize(nodes.size());
+	for (size_t i = 0; i < nodes.size(); i++)
+	{
+		const SceneNode& node = nodes[i];
+		nodeTransforms[i] = node.parent < 0 ? node.transform : nodeTransforms[node.parent] * node.transform;
+	}
+}
+
+void SceneGraph::UpdateBounds()
+{
+	bounds.resize(localBounds.size());
+	for (size_t i = 0; i < localBounds.size(); i++)
+		bounds[i] = TransformBounds(localBounds[i], GetMeshTransform(i));
+}
@@ -0,0 +1,63 @@
+#pragma once
+#include "BoundingVolumeHierarchy.h"
+#include "Frustum.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <glm/glm.hpp>
+#include <vector>
+
+// One node of an imported hierarchy. Nodes are stored parents first and the meshes of a node are a contiguous run of
+// the model's meshes, the order Model::ProcessNode visits them in.
+struct SceneNode
+{
+	glm::mat4 transform; // relative to the parent
+	int32_t parent;      // -1 for the root
+	uint32_t firstMesh;
+	uint32_t meshCount;
+};
+
+// The node hierarchy of a model with the transform of every node relative to the model, and a bounding volume
+// hierarchy over the model's meshes placed by their nodes. The volumes group meshes by where they are rather than by
+// the node they belong to, so one rejected subtree can cover meshes of many nodes.
+class SceneGraph
+{
+public:
+	// Takes the nodes of a model with meshCount meshes and computes their transforms. Meshes no node refers to keep
+	// the identity transform.
+	void SetNodes(std::vector<SceneNode> nodes, size_t meshCount);
+	// Builds the hierarchy from the bounds of every mesh in its own space, call once all of them are known
+	void Build(const CullBounds* meshBounds, size_t count);
+	bool IsBuilt() const { return built; }
+
+	size_t NodeCount() const { return nodes.size(); }
+	const std::vector<SceneNode>& GetNodes() const { return nodes; }
+	// relative to the model
+	const glm::mat4& GetNodeTransform(const size_t node) const { return nodeTransforms[node]; }
+	// -1 for meshes no node refers to
+	int32_t GetMeshNode(size_t mesh) const;
+	const glm::mat4& GetMeshTransform(size_t mesh) const;
+	// bounds of every mesh relative to the model, empty until Build
+	const std::vector<CullBounds>& GetMeshBounds() const { return bounds; }
+
+	// Moves a node together with its subtree, takes effect on the next Update
+	void SetLocalTransform(size_t node, const glm::mat4& transform);
+	// Recomputes the transforms after SetLocalTransform and refits the hierarchy to the meshes that moved
+	void Update();
+
+	// Sets visible[mesh] for every mesh, with the frustum relative to the model. Returns the number visible.
+	size_t Cull(const Frustum& frustum, unsigned char* visible) const;
+
+private:
+	std::vector<SceneNode> nodes;
+	std::vector<glm::mat4> nodeTransforms;
+	std::vector<int32_t> meshNodes;
+	std::vector<CullBounds> localBounds; // each mesh in its own space
+	std::vector<CullBounds> bounds;      // each mesh relative to the model
+	BoundingVolumeHierarchy hierarchy;
+	bool built = false;
+	bool moved = false;
+
+	void UpdateTransforms();
+	void UpdateBounds();
+};
@@ -2,11 +2,64 @@
 #define SHADER_H
 
 #include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include "GLState.h"
+#include "Hash.h"
+#include "Material.h"
 
 #include <string>
 #include <fstream>
 #include <sstream>
 #include <iostream>
+#include <unordered_map>
+#include <vector>
+
+// Names a uniform by the hash of its name. Built from a literal in a constant expression the hash is computed at
+// compile time, so keeping a handle around for hot paths costs no string work at all:
+//     constexpr UniformHandle POSITION_SCALE("positionScale");
+struct UniformHandle
+{
+	uint64_t hash;
+
+	constexpr UniformHandle(const char* name) : hash(HashString(name)) {}
+	UniformHandle(const std::string& name);
+};
+
+// Counts of what uniform updates cost, reset by the caller whenever it wants a per frame figure
+struct UniformStats
+{
+	size_t sets = 0;            // uniform values sent to the driver
+	size_t runtimeHashes = 0;   // handles hashed from a std::string at run time
+	size_t driverLookups = 0;   // glGetUniformLocation calls, only made while reflecting a program
+};
+
+inline UniformStats& GetUniformStats()
+{
+	static UniformStats stats;
+	return stats;
+}
+
+inline UniformHandle::UniformHandle(const std::string& name)
+	: hash(HashString(name.c_str()))
+{
+	GetUniformStats().runtimeHashes++;
+}
+
+// Uniform blocks with the same binding point in every program that declares them, so a buffer bound there serves all
+// of them. GLSL 330 can't name the binding in the shader.
+struct SharedUniformBlock
+{
+	const char* name;
+	GLuint binding;
+};
+
+const GLuint CAMERA_BLOCK_BINDING = 0; // see CameraUniformBuffer
+const GLuint OBJECT_BLOCK_BINDING = 1; // per draw, see FrameDataRing
+const SharedUniformBlock SHARED_UNIFORM_BLOCKS[] = {
+	{ "Camera", CAMERA_BLOCK_BINDING },
+	{ "Object", OBJECT_BLOCK_BINDING },
+};
 
 class Shader
 {
@@ -84,6 +137,7 @@ public:
 		glLinkProgram(id);
 
 		//print any linking errors
+		glGetProgramiv(id, GL_LINK_STATUS, &success);
 		if (!success)
 		{
 			glGetProgramInfoLog(id, 512, nullptr, infoLog);
@@ -92,38 +146,110 @@ public:
 
 		glDeleteShader(vertex);
 		glDeleteShader(fragment);
+
+		ReflectUniforms();
+		BindUniformBlocks();
 	}
 
 	void Use() const
 		//activate the shader
 	{
-		glUseProgram(id);
+		GLState::Get().UseProgram(id);
 	}
 
-	//utility uniform functions
-	void SetBool(const std::string& name, const bool value) const
+	// location of an active uniform, -1 (which glUniform ignores) for names the program doesn't use
+	GLint Location(const UniformHandle& uniform) const
 	{
-		glUniform1i(glGetUniformLocation(id, name.c_str()), static_cast<int>(value));
+		const auto found = uniformLocations.find(uniform.hash);
+		return found != uniformLocations.end() ? found->second : -1;
 	}
-	void SetInt(const std::string& name, const int value) const
+
+	//utility uniform functions, names are looked up in the table built at link time instead of asking the driver
+	void SetBool(const UniformHandle& uniform, const bool value) const
+	{
+		GetUniformStats().sets++;
+		glUniform1i(Location(uniform), static_cast<int>(value));
+	}
+	void SetInt(const UniformHandle& uniform, const int value) const
+	{
+		GetUniformStats().sets++;
+		glUniform1i(Location(uniform), value);
+	}
+	void SetFloat(const UniformHandle& uniform, const float value) const
 	{
-		glUniform1i(glGetUniformLocation(id, name.c_str()), value);
+		GetUniformStats().sets++;
+		glUniform1f(Location(uniform), value);
 	}
-	void SetFloat(const std::string& name, const float value) const
+	void SetMat4(const UniformHandle& uniform, const glm::mat4& value) const
 	{
-		glUniform1f(glGetUniformLocation(id, name.c_str()), value);
+		GetUniformStats().sets++;
+		glUniformMatrix4fv(Location(uniform), 1, GL_FALSE, &value[0][0]);
 	}
-	void SetMat4(const std::string& name, const glm::mat4& value) const
+	void SetVec3(const UniformHandle& uniform, const glm::vec3& value) const
 	{
-		glUniformMatrix4fv(glGetUniformLocation(id, name.c_str()), 1, GL_FALSE, &value[0][0]);
+		GetUniformStats().sets++;
+		glUniform3fv(Location(uniform), 1, &value[0]);
 	}
-	void SetVec3(const std::string& name, const glm::vec3& value) const
+	void SetVec3(const UniformHandle& uniform, const float x, const float y, const float z) const
 	{
-		glUniform3fv(glGetUniformLocation(id, name.c_str()), 1, &value[0]);
+		GetUniformStats().sets++;
+		glUniform3f(Location(uniform), x, y, z);
 	}
-	void SetVec3(const std::string& name, const float x, const float y, const float z) const
+
+private:
+	// name hash -> location of every active uniform, filled once after linking
+	std::unordered_map<uint64_t, GLint> uniformLocations;
+
+	// Also points every sampler at its unit from SamplerUnit, samplers are program state so this happens only once
+	void ReflectUniforms()
 	{
-		glUniform3f(glGetUniformLocation(id, name.c_str()), x, y, z);
+		// the previous program is back in place at the end, so GLState's shadow of it stays true
+		GLint previousProgram = 0;
+		glGetIntegerv(GL_CURRENT_PROGRAM, &previousProgram);
+		glUseProgram(id);
+
+		GLint count = 0, maxLength = 0;
+		glGetProgramiv(id, GL_ACTIVE_UNIFORMS, &count);
+		glGetProgramiv(id, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLength);
+		std::vector<GLchar> name(static_cast<size_t>(maxLength) + 1);
+		for (GLint i = 0; i < count; i++)
+		{
+			GLsizei length = 0;
+			GLint size = 0;
+			GLenum type = 0;
+			glGetActiveUniform(id, static_cast<GLuint>(i), static_cast<GLsizei>(name.size()), &length, &size, &type, name.data());
+			// uniforms inside blocks have no location of their own
+			const GLint location = glGetUniformLocation(id, name.data());
+			GetUniformStats().driverLookups++;
+			if (location < 0)
+				continue;
+
+			std::string uniformName(name.data(), static_cast<size_t>(length));
+			uniformLocations[HashString(uniformName.c_str())] = location;
+			// arrays are reported as "name[0]", make the plain name work too
+			const size_t suffix = uniformName.rfind("[0]");
+			if (suffix != std::string::npos && suffix + 3 == uniformName.size())
+				uniformLocations[HashString(uniformName.substr(0, suffix).c_str())] = location;
+
+			if (type == GL_SAMPLER_2D && size == 1)
+			{
+				const unsigned int unit = SamplerUnit(uniformName);
+				if (unit != INVALID_SAMPLER_UNIT)
+					glUniform1i(location, static_cast<GLint>(unit));
+			}
+		}
+
+		glUseProgram(static_cast<GLuint>(previousProgram));
+	}
+
+	void BindUniformBlocks() const
+	{
+		for (const SharedUniformBlock& block : SHARED_UNIFORM_BLOCKS)
+		{
+			const GLuint index = glGetUniformBlockIndex(id, block.name);
+			if (index != GL_INVALID_INDEX)
+				glUniformBlockBinding(id, index, block.binding);
+		}
 	}
 };
 #endif 
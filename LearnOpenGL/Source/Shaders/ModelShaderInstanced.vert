@@ -0,0 +1,22 @@
+#version 330 core
+layout (location = 0) in vec3 aPos;
+layout (location = 1) in vec3 aNormal;
+layout (location = 2) in vec2 aTexCoords;
+layout (location = 4) in mat4 aModel; // one per instance, see SetupInstanceAttributes
+
+out vec2 TexCoords;
+
+// shared by all programs, see CameraUniformBuffer
+layout (std140) uniform Camera
+{
+    mat4 view;
+    mat4 projection;
+    mat4 viewProjection;
+    vec3 viewPos;
+};
+
+void main()
+{
+    TexCoords = aTexCoords;
+    gl_Position = viewProjection * aModel * vec4(aPos, 1.0);
+}
\ No newline at end of file
@@ -0,0 +1,52 @@
+#version 330 core
+layout (location = 0) in vec4 aPos;
+layout (location = 1) in vec2 aNormal;
+layout (location = 2) in vec2 aTexCoords;
+layout (location = 3) in vec2 aTangent;
+
+out vec2 TexCoords;
+out mat3 TBN;
+
+// shared by all programs, see CameraUniformBuffer
+layout (std140) uniform Camera
+{
+    mat4 view;
+    mat4 projection;
+    mat4 viewProjection;
+    vec3 viewPos;
+};
+
+// per draw, written through FrameDataRing
+layout (std140) uniform Object
+{
+    mat4 model;
+};
+
+// positions are quantized to the bounds of their mesh
+uniform vec3 positionScale;
+uniform vec3 positionOffset;
+
+// inverse of EncodeOctahedral in Mesh.cpp
+vec3 OctDecode(vec2 e)
+{
+    vec3 v = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    if (v.z < 0.0)
+        v.xy = (1.0 - abs(v.yx)) * vec2(v.x >= 0.0 ? 1.0 : -1.0, v.y >= 0.0 ? 1.0 : -1.0);
+    return normalize(v);
+}
+
+void main()
+{
+    vec3 position = positionOffset + aPos.xyz * positionScale;
+
+    // position.w carries the bitangent handedness, 0 when it is flipped
+    mat3 normalMatrix = transpose(inverse(mat3(model)));
+    vec3 N = normalize(normalMatrix * OctDecode(aNormal));
+    vec3 T = normalize(mat3(model) * OctDecode(aTangent));
+    T = normalize(T - dot(T, N) * N);
+    vec3 B = cross(N, T) * (aPos.w > 0.5 ? 1.0 : -1.0);
+    TBN = mat3(T, B, N);
+
+    TexCoords = aTexCoords;
+    gl_Position = viewProjection * model * vec4(position, 1.0);
+}
\ No newline at end of file
@@ -4,8 +4,15 @@ layout (location = 1) in vec3 aNormal;
 layout (location = 2) in vec2 aTexCoord;
 
 uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
+
+// shared by all programs, see CameraUniformBuffer
+layout (std140) uniform Camera
+{
+    mat4 view;
+    mat4 projection;
+    mat4 viewProjection;
+    vec3 viewPos;
+};
 
 out vec3 FragPos;
 out vec3 Normal;
@@ -14,7 +21,7 @@ out vec2 TexCoords;
 void main()
 {
     // note that we read the multiplication from right to left
-    gl_Position = projection * view * model * vec4(aPos, 1.0);
+    gl_Position = viewProjection * model * vec4(aPos, 1.0);
     FragPos = vec3(view * model * vec4(aPos, 1.0));
     Normal = mat3(transpose(inverse(model * view))) * aNormal;
     TexCoords = aTexCoord;
@@ -0,0 +1,107 @@
+#include "TextureCache.h"
+#include "GLState.h"
+#include "Hash.h"
+#include "TextureStreamer.h"
+
+#include <cctype>
+#include <glad/glad.h>
+#include <iostream>
+#include <vector>
+
+TextureCache& TextureCache::Get()
+{
+	static TextureCache cache;
+	return cache;
+}
+
+unsigned int TextureCache::Acquire(const std::string& filename, TextureLoader& loader, const bool srgb)
+{
+	const std::string path = CanonicalPath(filename);
+	const uint64_t key = HashBytes(&srgb, sizeof(srgb), HashBytes(path.data(), path.size()));
+
+	const auto found = entries.find(key);
+	if (found != entries.end())
+	{
+		if (found->second.path == path && found->second.srgb == srgb)
+		{
+			hits++;
+			found->second.refCount++;
+			return found->second.textureId;
+		}
+
+		// a 64-bit collision is not expected in practice, load the second file uncached rather than alias it
+		std::cout << "ERROR::TEXTURECACHE::HASH COLLISION " << path << " " << found->second.path << std::endl;
+		misses++;
+		return loader.Load(filename, srgb);
+	}
+
+	misses++;
+	const unsigned int textureId = loader.Load(filename, srgb);
+	entries.emplace(key, Entry{ path, srgb, textureId, 1 });
+	keyByTexture.emplace(textureId, key);
+	return textureId;
+}
+
+void TextureCache::Release(const unsigned int textureId)
+{
+	const auto key = keyByTexture.find(textureId);
+	if (key == keyByTexture.end())
+	{
+		// uncached texture from a hash collision
+		TextureStreamer::Get().Remove(textureId);
+		GLState::Get().DeleteTexture(textureId);
+		return;
+	}
+
+	Entry& entry = entries.at(key->second);
+	if (--entry.refCount == 0)
+	{
+		TextureStreamer::Get().Remove(entry.textureId);
+		GLState::Get().DeleteTexture(entry.textureId);
+		entries.erase(key->second);
+		keyByTexture.erase(key);
+	}
+}
+
+std::string TextureCache::CanonicalPath(const std::string& path)
+{
+	std::vector<std::string> parts;
+	const bool absolute = !path.empty() && (path[0] == '/' || path[0] == '\\');
+
+	size_t start = 0;
+	while (start <= path.size())
+	{
+		size_t end = path.find_first_of("/\\", start);
+		if (end == std::string::npos)
+			end = path.size();
+		std::string part = path.substr(start, end - start);
+		start = end + 1;
+
+		if (part.empty() || part == ".")
+			continue;
+		if (part == "..")
+		{
+			// only leading ".." of a relative path survive
+			if (!parts.empty() && parts.back() != "..")
+				parts.pop_back();
+			else if (!absolute)
+				parts.push_back(part);
+			continue;
+		}
+#ifdef _WIN32
+		// the Windows file system is case insensitive
+		for (char& c : part)
+			c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+#endif
+		parts.push_back(std::move(part));
+	}
+
+	std::string canonical = absolute ? "/" : "";
+	for (size_t i = 0; i < parts.size(); i++)
+	{
+		if (i > 0)
+			canonical += '/';
+		canonical += parts[i];
+	}
+	return canonical;
+}
@@ -0,0 +1,44 @@
+#pragma once
+#include "TextureLoader.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+
+// Process-wide registry of loaded textures keyed by the hash of their canonical path.
+// Every Acquire is matched by a Release, the GL texture is deleted once the last reference is gone.
+// Like the rest of the GL resources it may only be used from the thread that owns the context.
+class TextureCache
+{
+public:
+	static TextureCache& Get();
+
+	// Returns the texture for filename, queueing it on loader only the first time it is seen.
+	// The sRGB and linear versions of a file are separate textures, see TextureLoader::Load.
+	unsigned int Acquire(const std::string& filename, TextureLoader& loader, bool srgb = false);
+	void Release(unsigned int textureId);
+
+	size_t Hits() const { return hits; }
+	size_t Misses() const { return misses; }
+	size_t ResidentCount() const { return entries.size(); }
+
+	// Lexically normalized path, so "a/./b.png", "a\\b.png" and "a/c/../b.png" share one entry
+	static std::string CanonicalPath(const std::string& path);
+
+private:
+	struct Entry
+	{
+		std::string path;
+		bool srgb;
+		unsigned int textureId;
+		unsigned int refCount;
+	};
+
+	std::unordered_map<uint64_t, Entry> entries;
+	std::unordered_map<unsigned int, uint64_t> keyByTexture;
+	size_t hits = 0;
+	size_t misses = 0;
+
+	TextureCache() = default;
+};
@@ -0,0 +1,454 @@
+#include "TextureCompression.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <glm/glm.hpp>
+
+namespace
+{
+	const uint32_t INTERNAL_FORMAT_BC1 = 0x83F0; // GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+	const uint32_t INTERNAL_FORMAT_BC3 = 0x83F3; // GL_COMPRESSED_RGBA_S3TC_DXT5_EXT
+	const uint32_t INTERNAL_FORMAT_BC5 = 0x8DBD; // GL_COMPRESSED_RG_RGTC2
+	const uint32_t INTERNAL_FORMAT_BC1_SRGB = 0x8C4C; // GL_COMPRESSED_SRGB_S3TC_DXT1_EXT
+	const uint32_t INTERNAL_FORMAT_BC3_SRGB = 0x8C4F; // GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT
+	const uint32_t BASE_FORMAT_RGB = 0x1907;
+	const uint32_t BASE_FORMAT_RGBA = 0x1908;
+	const uint32_t BASE_FORMAT_RG = 0x8227;
+
+	uint16_t Pack565(const glm::vec3& color)
+	{
+		const auto quantize = [](const float value, const float maximum)
+		{
+			return static_cast<uint16_t>(glm::clamp(std::lround(value * maximum / 255.0f), 0L, static_cast<long>(maximum)));
+		};
+		return static_cast<uint16_t>(quantize(color.r, 31.0f) << 11 | quantize(color.g, 63.0f) << 5 | quantize(color.b, 31.0f));
+	}
+
+	glm::vec3 Unpack565(const uint16_t color)
+	{
+		const int r = color >> 11 & 31, g = color >> 5 & 63, b = color & 31;
+		return glm::vec3(static_cast<float>(r << 3 | r >> 2), static_cast<float>(g << 2 | g >> 4), static_cast<float>(b << 3 | b >> 2));
+	}
+
+	// The four colors of an opaque block. Equal endpoints decode in three color mode, only index 0 is usable then.
+	int BuildColorPalette(const uint16_t color0, const uint16_t color1, glm::vec3 palette[4])
+	{
+		palette[0] = Unpack565(color0);
+		palette[1] = Unpack565(color1);
+		palette[2] = (palette[0] * 2.0f + palette[1]) / 3.0f;
+		palette[3] = (palette[0] + palette[1] * 2.0f) / 3.0f;
+		return color0 == color1 ? 1 : 4;
+	}
+
+	// Fits the endpoints to the principal axis of the block colors, then refines them by least squares against the
+	// index assignment a few times and keeps whichever pass had the lowest error
+	void EncodeColorBlock(const unsigned char* rgba, unsigned char* out)
+	{
+		glm::vec3 colors[16];
+		glm::vec3 mean(0.0f);
+		for (int i = 0; i < 16; i++)
+		{
+			colors[i] = glm::vec3(rgba[i * 4], rgba[i * 4 + 1], rgba[i * 4 + 2]);
+			mean += colors[i];
+		}
+		mean /= 16.0f;
+
+		glm::mat3 covariance(0.0f);
+		for (const glm::vec3& color : colors)
+			covariance += glm::outerProduct(color - mean, color - mean);
+		glm::vec3 axis(0.57735f);
+		for (int iteration = 0; iteration < 8; iteration++)
+		{
+			const glm::vec3 next = covariance * axis;
+			const float length = glm::length(next);
+			if (length < 1e-6f)
+				break;
+			axis = next / length;
+		}
+
+		float low = std::numeric_limits<float>::max(), high = -std::numeric_limits<float>::max();
+		for (const glm::vec3& color : colors)
+		{
+			const float projection = glm::dot(color - mean, axis);
+			low = std::min(low, projection);
+			high = std::max(high, projection);
+		}
+		glm::vec3 endpoint0 = mean + axis * high;
+		glm::vec3 endpoint1 = mean + axis * low;
+
+		static const float endpoint0Weights[4] = { 1.0f, 0.0f, 2.0f / 3.0f, 1.0f / 3.0f };
+		uint16_t bestColor0 = 0, bestColor1 = 0;
+		uint32_t bestIndices = 0;
+		float bestError = std::numeric_limits<float>::max();
+		for (int iteration = 0; iteration < 3; iteration++)
+		{
+			uint16_t color0 = Pack565(endpoint0), color1 = Pack565(endpoint1);
+			if (color0 < color1)
+				std::swap(color0, color1);
+			glm::vec3 palette[4];
+			const int paletteSize = BuildColorPalette(color0, color1, palette);
+
+			uint32_t indices = 0;
+			int assigned[16];
+			float error = 0.0f;
+			for (int i = 0; i < 16; i++)
+			{
+				int best = 0;
+				float bestDistance = std::numeric_limits<float>::max();
+				for (int p = 0; p < paletteSize; p++)
+				{
+					const glm::vec3 difference = colors[i] - palette[p];
+					const float distance = glm::dot(difference, difference);
+					if (distance < bestDistance)
+					{
+						bestDistance = distance;
+						best = p;
+					}
+				}
+				assigned[i] = best;
+				indices |= static_cast<uint32_t>(best) << (2 * i);
+				error += bestDistance;
+			}
+
+			if (error < bestError)
+			{
+				bestError = error;
+				bestColor0 = color0;
+				bestColor1 = color1;
+				bestIndices = indices;
+			}
+			if (error == 0.0f || paletteSize == 1)
+				break;
+
+			// every color is approximated as a * endpoint0 + (1 - a) * endpoint1, solve the normal equations for both endpoints
+			float aa = 0.0f, ab = 0.0f, bb = 0.0f;
+			glm::vec3 ax(0.0f), bx(0.0f);
+			for (int i = 0; i < 16; i++)
+			{
+				const float a = endpoint0Weights[assigned[i]];
+				const float b = 1.0f - a;
+				aa += a * a;
+				ab += a * b;
+				bb += b * b;
+				ax += colors[i] * a;
+				bx += colors[i] * b;
+			}
+			const float determinant = aa * bb - ab * ab;
+			if (std::abs(determinant) < 1e-6f)
+				break;
+			endpoint0 = glm::clamp((ax * bb - bx * ab) / determinant, 0.0f, 255.0f);
+			endpoint1 = glm::clamp((bx * aa - ax * ab) / determinant, 0.0f, 255.0f);
+		}
+
+		out[0] = static_cast<unsigned char>(bestColor0);
+		out[1] = static_cast<unsigned char>(bestColor0 >> 8);
+		out[2] = static_cast<unsigned char>(bestColor1);
+		out[3] = static_cast<unsigned char>(bestColor1 >> 8);
+		for (int i = 0; i < 4; i++)
+			out[4 + i] = static_cast<unsigned char>(bestIndices >> (8 * i));
+	}
+
+	// Eight interpolated values if value0 > value1, otherwise six plus exact 0 and 255
+	void BuildChannelPalette(const int value0, const int value1, int palette[8])
+	{
+		palette[0] = value0;
+		palette[1] = value1;
+		if (value0 > value1)
+		{
+			for (int i = 1; i < 7; i++)
+				palette[i + 1] = ((7 - i) * value0 + i * value1 + 3) / 7;
+		}
+		else
+		{
+			for (int i = 1; i < 5; i++)
+				palette[i + 1] = ((5 - i) * value0 + i * value1 + 2) / 5;
+			palette[6] = 0;
+			palette[7] = 255;
+		}
+	}
+
+	int AssignChannelIndices(const unsigned char* values, const int palette[8], uint64_t& indices)
+	{
+		int error = 0;
+		indices = 0;
+		for (int i = 0; i < 16; i++)
+		{
+			int best = 0;
+			int bestDistance = std::numeric_limits<int>::max();
+			for (int p = 0; p < 8; p++)
+			{
+				const int distance = (values[i] - palette[p]) * (values[i] - palette[p]);
+				if (distance < bestDistance)
+				{
+					bestDistance = distance;
+					best = p;
+				}
+			}
+			indices |= static_cast<uint64_t>(best) << (3 * i);
+			error += bestDistance;
+		}
+		return error;
+	}
+
+	// BC4 block, the alpha half of BC3 and each half of BC5
+	void EncodeChannelBlock(const unsigned char* values, unsigned char* out)
+	{
+		int minimum = 255, maximum = 0;
+		int innerMinimum = 255, innerMaximum = 0;
+		for (int i = 0; i < 16; i++)
+		{
+			minimum = std::min<int>(minimum, values[i]);
+			maximum = std::max<int>(maximum, values[i]);
+			if (values[i] != 0 && values[i] != 255)
+			{
+				innerMinimum = std::min<int>(innerMinimum, values[i]);
+				innerMaximum = std::max<int>(innerMaximum, values[i]);
+			}
+		}
+
+		int palette[8];
+		uint64_t indices;
+		int value0 = maximum, value1 = minimum;
+		BuildChannelPalette(value0, value1, palette);
+		int error = AssignChannelIndices(values, palette, indices);
+
+		// blocks touching the ends of the range may do better with the six value mode, which has exact 0 and 255
+		if (error > 0 && (minimum == 0 || maximum == 255))
+		{
+			if (innerMinimum > innerMaximum)
+				innerMinimum = innerMaximum = 0;
+			int sixPalette[8];
+			uint64_t sixIndices;
+			BuildChannelPalette(innerMinimum, innerMaximum, sixPalette);
+			const int sixError = AssignChannelIndices(values, sixPalette, sixIndices);
+			if (sixError < error)
+			{
+				value0 = innerMinimum;
+				value1 = innerMaximum;
+				indices = sixIndices;
+			}
+		}
+
+		out[0] = static_cast<unsigned char>(value0);
+		out[1] = static_cast<unsigned char>(value1);
+		for (int i = 0; i < 6; i++)
+			out[2 + i] = static_cast<unsigned char>(indices >> (8 * i));
+	}
+
+	void DecodeColorBlock(const unsigned char* in, unsigned char* rgba, const bool alwaysFourColors)
+	{
+		const uint16_t color0 = static_cast<uint16_t>(in[0] | in[1] << 8);
+		const uint16_t color1 = static_cast<uint16_t>(in[2] | in[3] << 8);
+		glm::vec3 palette[4];
+		BuildColorPalette(color0, color1, palette);
+		unsigned char alpha[4] = { 255, 255, 255, 255 };
+		if (color0 <= color1 && !alwaysFourColors)
+		{
+			palette[2] = (palette[0] + palette[1]) * 0.5f;
+			palette[3] = glm::vec3(0.0f);
+			alpha[3] = 0;
+		}
+
+		const uint32_t indices = static_cast<uint32_t>(in[4] | in[5] << 8 | in[6] << 16) | static_cast<uint32_t>(in[7]) << 24;
+		for (int i = 0; i < 16; i++)
+		{
+			const uint32_t index = indices >> (2 * i) & 3;
+			for (int c = 0; c < 3; c++)
+				rgba[i * 4 + c] = static_cast<unsigned char>(std::lround(palette[index][c]));
+			rgba[i * 4 + 3] = alpha[index];
+		}
+	}
+
+	void DecodeChannelBlock(const unsigned char* in, unsigned char* rgba, const int channel)
+	{
+		int palette[8];
+		BuildChannelPalette(in[0], in[1], palette);
+		uint64_t indices = 0;
+		for (int i = 0; i < 6; i++)
+			indices |= static_cast<uint64_t>(in[2 + i]) << (8 * i);
+		for (int i = 0; i < 16; i++)
+			rgba[i * 4 + channel] = static_cast<unsigned char>(palette[indices >> (3 * i) & 7]);
+	}
+
+	void FetchBlock(const unsigned char* rgba, const int width, const int height, const int blockX, const int blockY, unsigned char* block)
+	{
+		for (int y = 0; y < 4; y++)
+		{
+			const int sourceY = std::min(blockY * 4 + y, height - 1);
+			for (int x = 0; x < 4; x++)
+			{
+				const int sourceX = std::min(blockX * 4 + x, width - 1);
+				std::memcpy(block + (y * 4 + x) * 4, rgba + (static_cast<size_t>(sourceY) * width + sourceX) * 4, 4);
+			}
+		}
+	}
+
+	void StoreBlock(const unsigned char* block, const int width, const int height, const int blockX, const int blockY, unsigned char* rgba)
+	{
+		for (int y = 0; y < 4 && blockY * 4 + y < height; y++)
+		{
+			for (int x = 0; x < 4 && blockX * 4 + x < width; x++)
+				std::memcpy(rgba + (static_cast<size_t>(blockY * 4 + y) * width + blockX * 4 + x) * 4, block + (y * 4 + x) * 4, 4);
+		}
+	}
+}
+
+size_t BlockBytes(const BlockFormat format)
+{
+	return format == BlockFormat::BC1 ? 8 : 16;
+}
+
+size_t CompressedSize(const int width, const int height, const BlockFormat format)
+{
+	return static_cast<size_t>((width + 3) / 4) * ((height + 3) / 4) * BlockBytes(format);
+}
+
+uint32_t GlInternalFormat(const BlockFormat format, const bool srgb)
+{
+	switch (format)
+	{
+	case BlockFormat::BC1: return srgb ? INTERNAL_FORMAT_BC1_SRGB : INTERNAL_FORMAT_BC1;
+	case BlockFormat::BC3: return srgb ? INTERNAL_FORMAT_BC3_SRGB : INTERNAL_FORMAT_BC3;
+	default: return INTERNAL_FORMAT_BC5;
+	}
+}
+
+uint32_t GlBaseInternalFormat(const BlockFormat format)
+{
+	switch (format)
+	{
+	case BlockFormat::BC1: return BASE_FORMAT_RGB;
+	case BlockFormat::BC3: return BASE_FORMAT_RGBA;
+	default: return BASE_FORMAT_RG;
+	}
+}
+
+bool BlockFormatFromGl(const uint32_t internalFormat, BlockFormat& format, bool& srgb)
+{
+	for (const BlockFormat candidate : { BlockFormat::BC1, BlockFormat::BC3, BlockFormat::BC5 })
+	{
+		for (const bool candidateSrgb : { false, true })
+		{
+			if (GlInternalFormat(candidate, candidateSrgb) == internalFormat)
+			{
+				format = candidate;
+				srgb = candidateSrgb && candidate != BlockFormat::BC5;
+				return true;
+			}
+		}
+	}
+	return false;
+}
+
+int FormatChannels(const BlockFormat format)
+{
+	switch (format)
+	{
+	case BlockFormat::BC1: return 3;
+	case BlockFormat::BC3: return 4;
+	default: return 2;
+	}
+}
+
+std::vector<unsigned char> CompressImage(const unsigned char* rgba, const int width, const int height, const BlockFormat format, ThreadPool* pool)
+{
+	const int blocksX = (width + 3) / 4;
+	const int blocksY = (height + 3) / 4;
+	const size_t blockBytes = BlockBytes(format);
+	std::vector<unsigned char> blocks(CompressedSize(width, height, format));
+
+	const auto encodeRows = [&](const size_t begin, const size_t end)
+	{
+		unsigned char block[64];
+		unsigned char channel[16];
+		for (size_t blockY = begin; blockY < end; blockY++)
+		{
+			for (int blockX = 0; blockX < blocksX; blockX++)
+			{
+				FetchBlock(rgba, width, height, blockX, static_cast<int>(blockY), block);
+				unsigned char* out = blocks.data() + (blockY * blocksX + blockX) * blockBytes;
+				switch (format)
+				{
+				case BlockFormat::BC1:
+					EncodeColorBlock(block, out);
+					break;
+				case BlockFormat::BC3:
+					for (int i = 0; i < 16; i++)
+						channel[i] = block[i * 4 + 3];
+					EncodeChannelBlock(channel, out);
+					EncodeColorBlock(block, out + 8);
+					break;
+				case BlockFormat::BC5:
+					for (int c = 0; c < 2; c++)
+					{
+						for (int i = 0; i < 16; i++)
+							channel[i] = block[i * 4 + c];
+						EncodeChannelBlock(channel, out + c * 8);
+					}
+					break;
+				}
+			}
+		}
+	};
+
+	if (pool)
+		pool->ParallelFor(blocksY, encodeRows);
+	else
+		encodeRows(0, blocksY);
+	return blocks;
+}
+
+std::vector<unsigned char> DecompressImage(const unsigned char* blocks, const int width, const int height, const BlockFormat format)
+{
+	const int blocksX = (width + 3) / 4;
+	const int blocksY = (height + 3) / 4;
+	const size_t blockBytes = BlockBytes(format);
+	std::vector<unsigned char> rgba(static_cast<size_t>(width) * height * 4);
+
+	unsigned char block[64];
+	for (int blockY = 0; blockY < blocksY; blockY++)
+	{
+		for (int blockX = 0; blockX < blocksX; blockX++)
+		{
+			const unsigned char* in = blocks + (static_cast<size_t>(blockY) * blocksX + blockX) * blockBytes;
+			switch (format)
+			{
+			case BlockFormat::BC1:
+				DecodeColorBlock(in, block, false);
+				break;
+			case BlockFormat::BC3:
+				DecodeColorBlock(in + 8, block, true);
+				DecodeChannelBlock(in, block, 3);
+				break;
+			case BlockFormat::BC5:
+				std::memset(block, 0, sizeof(block));
+				DecodeChannelBlock(in, block, 0);
+				DecodeChannelBlock(in + 8, block, 1);
+				for (int i = 0; i < 16; i++)
+					block[i * 4 + 3] = 255;
+				break;
+			}
+			StoreBlock(block, width, height, blockX, blockY, rgba.data());
+		}
+	}
+	return rgba;
+}
+
+double ComputePsnr(const unsigned char* a, const unsigned char* b, const size_t pixelCount, const int channels)
+{
+	double squaredError = 0.0;
+	for (size_t i = 0; i < pixelCount; i++)
+	{
+		for (int c = 0; c < channels; c++)
+		{
+			const double difference = static_cast<double>(a[i * 4 + c]) - b[i * 4 + c];
+			squaredError += difference * difference;
+		}
+	}
+	if (squaredError == 0.0)
+		return std::numeric_limits<double>::infinity();
+	const double meanSquaredError = squaredError / (static_cast<double>(pixelCount) * channels);
+	return 10.0 * std::log10(255.0 * 255.0 / meanSquaredError);
+}
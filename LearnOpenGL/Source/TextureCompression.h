@@ -0,0 +1,51 @@
+#pragma once
+#include "ThreadPool.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// CPU encoder and decoder for the block compressed formats of GL 3.3 class hardware. Everything here works on
+// RGBA8 pixels in memory and needs no GL context, so cooking and quality checks can run without a GPU.
+
+enum class BlockFormat
+{
+	BC1, // DXT1, opaque RGB at 4 bits per pixel
+	BC3, // DXT5, RGB plus interpolated alpha at 8 bits per pixel
+	BC5  // RGTC2, two independent channels at 8 bits per pixel, for normal maps (z is rebuilt in the shader)
+};
+
+struct CompressedMip
+{
+	int width, height;
+	std::vector<unsigned char> data;
+};
+
+struct CompressedImage
+{
+	BlockFormat format;
+	bool srgb; // color data whose mips were filtered in linear light
+	std::vector<CompressedMip> mips;
+};
+
+size_t BlockBytes(BlockFormat format);
+size_t CompressedSize(int width, int height, BlockFormat format);
+
+// GL enums of the matching compressed internal format and its base format, as written to KTX headers.
+// BC5 has no sRGB variant and ignores srgb.
+uint32_t GlInternalFormat(BlockFormat format, bool srgb);
+uint32_t GlBaseInternalFormat(BlockFormat format);
+bool BlockFormatFromGl(uint32_t internalFormat, BlockFormat& format, bool& srgb);
+
+// Number of RGBA channels a format keeps, the ones quality checks should compare
+int FormatChannels(BlockFormat format);
+
+// Encodes an RGBA8 image, rows of blocks are spread over the pool when one is given.
+// Edge blocks of sizes that are not a multiple of four repeat their last row and column.
+std::vector<unsigned char> CompressImage(const unsigned char* rgba, int width, int height, BlockFormat format, ThreadPool* pool = nullptr);
+
+// Reference decoder following the D3D10 rules, returns RGBA8. Channels a format doesn't store read as 0, alpha as 255.
+std::vector<unsigned char> DecompressImage(const unsigned char* blocks, int width, int height, BlockFormat format);
+
+// Peak signal to noise ratio in dB over the first channels of two RGBA8 images, infinite if they are identical
+double ComputePsnr(const unsigned char* a, const unsigned char* b, size_t pixelCount, int channels);
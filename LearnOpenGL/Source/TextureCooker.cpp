@@ -0,0 +1,248 @@
+#include "TextureCooker.h"
+#include "Hash.h"
+#include "MappedFile.h"
+#include "MipGenerator.h"
+#include "../Dependencies/stb_image.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+namespace
+{
+	const unsigned char KTX_IDENTIFIER[12] = { 0xAB, 'K', 'T', 'X', ' ', '1', '1', 0xBB, '\r', '\n', 0x1A, '\n' };
+	const uint32_t KTX_ENDIANNESS = 0x04030201;
+	// key of the metadata entry that ties the file to its source, the value is a CookKey
+	const char COOK_KEY[] = "LearnOpenGL.cook";
+
+	struct KtxHeader
+	{
+		uint32_t endianness;
+		uint32_t glType;
+		uint32_t glTypeSize;
+		uint32_t glFormat;
+		uint32_t glInternalFormat;
+		uint32_t glBaseInternalFormat;
+		uint32_t pixelWidth;
+		uint32_t pixelHeight;
+		uint32_t pixelDepth;
+		uint32_t numberOfArrayElements;
+		uint32_t numberOfFaces;
+		uint32_t numberOfMipmapLevels;
+		uint32_t bytesOfKeyValueData;
+	};
+
+	struct CookKey
+	{
+		uint64_t sourceHash;
+		uint32_t version;
+		uint32_t srgb; // the mips of color data are filtered in linear light, so the chain depends on it
+	};
+
+	size_t Padded(const size_t bytes)
+	{
+		return (bytes + 3) & ~static_cast<size_t>(3);
+	}
+}
+
+std::string TextureCooker::CachePath(const std::string& sourcePath)
+{
+	return sourcePath + ".ktx";
+}
+
+uint64_t TextureCooker::HashSource(const std::string& sourcePath)
+{
+	const MappedFile source(sourcePath);
+	if (!source.IsOpen())
+		return 0;
+	return HashBytes(source.Data(), source.Size());
+}
+
+bool TextureCooker::Load(const std::string& sourcePath, const uint64_t sourceHash, const bool srgb, CompressedImage& image)
+{
+	const MappedFile file(CachePath(sourcePath));
+	if (!file.IsOpen() || sourceHash == 0)
+		return false;
+
+	size_t offset = 0;
+	const auto take = [&](const size_t bytes) -> const unsigned char*
+	{
+		if (bytes > file.Size() - offset)
+			return nullptr;
+		const unsigned char* result = file.Data() + offset;
+		offset += bytes;
+		return result;
+	};
+
+	const unsigned char* identifier = take(sizeof(KTX_IDENTIFIER));
+	const unsigned char* headerData = take(sizeof(KtxHeader));
+	if (!identifier || !headerData || std::memcmp(identifier, KTX_IDENTIFIER, sizeof(KTX_IDENTIFIER)) != 0)
+		return false;
+	KtxHeader header;
+	std::memcpy(&header, headerData, sizeof(header));
+	BlockFormat format;
+	bool formatSrgb;
+	if (header.endianness != KTX_ENDIANNESS || !BlockFormatFromGl(header.glInternalFormat, format, formatSrgb) || header.pixelWidth == 0 ||
+		header.pixelHeight == 0 || header.numberOfFaces != 1 || header.numberOfArrayElements != 0 || header.numberOfMipmapLevels > 32)
+		return false;
+
+	// only a file carrying our key for this exact source is trusted
+	bool matches = false;
+	const unsigned char* keyValueData = take(header.bytesOfKeyValueData);
+	for (size_t position = 0; keyValueData && position + sizeof(uint32_t) <= header.bytesOfKeyValueData;)
+	{
+		uint32_t entryBytes;
+		std::memcpy(&entryBytes, keyValueData + position, sizeof(entryBytes));
+		position += sizeof(entryBytes);
+		if (entryBytes > header.bytesOfKeyValueData - position)
+			return false;
+		if (entryBytes == sizeof(COOK_KEY) + sizeof(CookKey) && std::memcmp(keyValueData + position, COOK_KEY, sizeof(COOK_KEY)) == 0)
+		{
+			CookKey key;
+			std::memcpy(&key, keyValueData + position + sizeof(COOK_KEY), sizeof(key));
+			matches = key.sourceHash == sourceHash && key.version == VERSION && (key.srgb != 0) == srgb && formatSrgb == srgb;
+		}
+		position += Padded(entryBytes);
+	}
+	if (!keyValueData || !matches)
+		return false;
+
+	CompressedImage loaded;
+	loaded.format = format;
+	loaded.srgb = formatSrgb;
+	loaded.mips.resize(std::max<uint32_t>(header.numberOfMipmapLevels, 1));
+	int width = static_cast<int>(header.pixelWidth), height = static_cast<int>(header.pixelHeight);
+	for (CompressedMip& mip : loaded.mips)
+	{
+		const unsigned char* sizeData = take(sizeof(uint32_t));
+		if (!sizeData)
+			return false;
+		uint32_t imageSize;
+		std::memcpy(&imageSize, sizeData, sizeof(imageSize));
+		const unsigned char* data = take(Padded(imageSize));
+		if (!data || imageSize != CompressedSize(width, height, format))
+			return false;
+
+		mip.width = width;
+		mip.height = height;
+		mip.data.assign(data, data + imageSize);
+		width = std::max(width / 2, 1);
+		height = std::max(height / 2, 1);
+	}
+
+	image = std::move(loaded);
+	return true;
+}
+
+bool TextureCooker::Store(const std::string& sourcePath, const uint64_t sourceHash, const CompressedImage& image)
+{
+	if (sourceHash == 0 || image.mips.empty())
+		return false;
+
+	// write to a temporary file first so a partially written file is never picked up
+	const std::string cachePath = CachePath(sourcePath);
+	const std::string tempPath = cachePath + ".tmp";
+	{
+		std::ofstream out(tempPath, std::ios::binary | std::ios::trunc);
+		if (!out)
+		{
+			std::cout << "ERROR::TEXTURECOOKER::COULD NOT WRITE " << tempPath << std::endl;
+			return false;
+		}
+
+		const uint32_t entryBytes = sizeof(COOK_KEY) + sizeof(CookKey);
+		KtxHeader header{};
+		header.endianness = KTX_ENDIANNESS;
+		header.glTypeSize = 1;
+		header.glInternalFormat = GlInternalFormat(image.format, image.srgb);
+		header.glBaseInternalFormat = GlBaseInternalFormat(image.format);
+		header.pixelWidth = static_cast<uint32_t>(image.mips[0].width);
+		header.pixelHeight = static_cast<uint32_t>(image.mips[0].height);
+		header.numberOfFaces = 1;
+		header.numberOfMipmapLevels = static_cast<uint32_t>(image.mips.size());
+		header.bytesOfKeyValueData = static_cast<uint32_t>(sizeof(entryBytes) + Padded(entryBytes));
+		out.write(reinterpret_cast<const char*>(KTX_IDENTIFIER), sizeof(KTX_IDENTIFIER));
+		out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+		const CookKey key{ sourceHash, VERSION, image.srgb ? 1u : 0u };
+		static const char padding[4] = {};
+		out.write(reinterpret_cast<const char*>(&entryBytes), sizeof(entryBytes));
+		out.write(COOK_KEY, sizeof(COOK_KEY));
+		out.write(reinterpret_cast<const char*>(&key), sizeof(key));
+		out.write(padding, Padded(entryBytes) - entryBytes);
+
+		for (const CompressedMip& mip : image.mips)
+		{
+			const auto imageSize = static_cast<uint32_t>(mip.data.size());
+			out.write(reinterpret_cast<const char*>(&imageSize), sizeof(imageSize));
+			out.write(reinterpret_cast<const char*>(mip.data.data()), mip.data.size());
+			out.write(padding, Padded(imageSize) - imageSize);
+		}
+
+		if (!out)
+		{
+			std::cout << "ERROR::TEXTURECOOKER::COULD NOT WRITE " << tempPath << std::endl;
+			return false;
+		}
+	}
+
+	std::remove(cachePath.c_str());
+	return std::rename(tempPath.c_str(), cachePath.c_str()) == 0;
+}
+
+bool TextureCooker::Cook(const std::string& sourcePath, const bool normalMap, const bool srgb, ThreadPool& pool, TextureCookReport* report)
+{
+	const MappedFile source(sourcePath);
+	int width, height, numComponents;
+	unsigned char* pixels = source.IsOpen()
+		? stbi_load_from_memory(source.Data(), static_cast<int>(source.Size()), &width, &height, &numComponents, 4)
+		: nullptr;
+	if (!pixels)
+	{
+		std::cout << "ERROR::TEXTURECOOKER::COULD NOT DECODE " << sourcePath << std::endl;
+		return false;
+	}
+	std::vector<unsigned char> level(pixels, pixels + static_cast<size_t>(width) * height * 4);
+	stbi_image_free(pixels);
+
+	// an alpha channel that is opaque everywhere is dropped rather than paying for BC3
+	bool translucent = false;
+	for (size_t i = 3; i < level.size() && !translucent; i += 4)
+		translucent = level[i] != 255;
+
+	CompressedImage image;
+	image.format = normalMap ? BlockFormat::BC5 : translucent ? BlockFormat::BC3 : BlockFormat::BC1;
+	image.srgb = srgb && !normalMap;
+	TextureCookReport cookReport;
+	cookReport.width = width;
+	cookReport.height = height;
+	cookReport.format = image.format;
+
+	const std::vector<MipLevel> chain = GenerateMipChain(level.data(), width, height, image.srgb);
+	for (size_t mipLevel = 0; mipLevel <= chain.size(); mipLevel++)
+	{
+		const int mipWidth = mipLevel == 0 ? width : chain[mipLevel - 1].width;
+		const int mipHeight = mipLevel == 0 ? height : chain[mipLevel - 1].height;
+		const unsigned char* rgba = mipLevel == 0 ? level.data() : chain[mipLevel - 1].rgba.data();
+
+		const auto start = std::chrono::steady_clock::now();
+		CompressedMip mip{ mipWidth, mipHeight, CompressImage(rgba, mipWidth, mipHeight, image.format, &pool) };
+		cookReport.encodeMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+		cookReport.uncompressedBytes += static_cast<size_t>(mipWidth) * mipHeight * 4;
+		cookReport.compressedBytes += mip.data.size();
+
+		if (mipLevel == 0)
+		{
+			const std::vector<unsigned char> decoded = DecompressImage(mip.data.data(), mipWidth, mipHeight, image.format);
+			cookReport.psnr = ComputePsnr(level.data(), decoded.data(), level.size() / 4, FormatChannels(image.format));
+		}
+		image.mips.push_back(std::move(mip));
+	}
+
+	if (report)
+		*report = cookReport;
+	return Store(sourcePath, HashBytes(source.Data(), source.Size()), image);
+}
@@ -0,0 +1,40 @@
+#pragma once
+#include "TextureCompression.h"
+#include "ThreadPool.h"
+
+#include <cstdint>
+#include <string>
+
+struct TextureCookReport
+{
+	int width = 0, height = 0;
+	BlockFormat format = BlockFormat::BC1;
+	size_t uncompressedBytes = 0; // RGBA8 with the full mip chain, what the raw path keeps in VRAM
+	size_t compressedBytes = 0;
+	double encodeMs = 0.0;
+	double psnr = 0.0; // of the top level, decoded back on the CPU
+};
+
+// Offline texture cooking: decodes a source image, builds its mip chain and block compresses every level into a
+// KTX 1.1 file next to the source. Like the mesh cache an entry is only valid for the exact source contents it was
+// cooked from and the color space it was cooked for, so a stale, mismatching or missing file simply sends the loader
+// back to the source image.
+class TextureCooker
+{
+public:
+	// bump whenever the encoder or the mip filter changes its output
+	static const uint32_t VERSION = 3;
+
+	static std::string CachePath(const std::string& sourcePath);
+
+	// hash of the source file contents, 0 if the file can't be read
+	static uint64_t HashSource(const std::string& sourcePath);
+
+	// srgb is what the caller samples the texture as, a file cooked for the other color space is rejected
+	static bool Load(const std::string& sourcePath, uint64_t sourceHash, bool srgb, CompressedImage& image);
+	static bool Store(const std::string& sourcePath, uint64_t sourceHash, const CompressedImage& image);
+
+	// Images with alpha become BC3, everything else BC1 unless normalMap asks for BC5. srgb marks color data, its
+	// mips are filtered in linear light. Must not be called from a worker of pool, the encoder spreads every level over it.
+	static bool Cook(const std::string& sourcePath, bool normalMap, bool srgb, ThreadPool& pool, TextureCookReport* report = nullptr);
+};
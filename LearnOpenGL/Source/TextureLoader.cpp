@@ -0,0 +1,218 @@
+#include "TextureLoader.h"
+#include "TextureCooker.h"
+#include "GLState.h"
+#include "TextureUploadRing.h"
+#include "Hash.h"
+#include "MappedFile.h"
+#include "../Dependencies/stb_image.h"
+
+#include <cstring>
+#include <glad/glad.h>
+#include <iostream>
+
+TextureLoader::TextureLoader(ThreadPool& pool, const bool useCooked, const bool stream)
+	: pool(pool), useCooked(useCooked && SupportsCookedTextures()), stream(stream)
+{
+}
+
+TextureLoader::~TextureLoader()
+{
+	// workers hold a pointer to this loader, so every outstanding decode has to land before it goes away
+	Finish();
+}
+
+unsigned int TextureLoader::Load(const std::string& filename, const bool srgb)
+{
+	DecodedImage image{};
+	glGenTextures(1, &image.textureId);
+	image.filename = filename;
+	image.srgb = srgb;
+	image.stream = stream;
+
+	static const unsigned char placeholder[] = { 128, 128, 128 };
+	GLState::Get().BindTexture(image.textureId);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, 1, 1, 0, GL_RGB, GL_UNSIGNED_BYTE, placeholder);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		pending++;
+	}
+	pool.Enqueue([this, image]() mutable
+	{
+		Decode(image, useCooked);
+		// notify under the lock, once Finish sees the last image the loader may be destroyed
+		std::lock_guard<std::mutex> lock(mutex);
+		completed.push_back(std::move(image));
+		decoded.notify_one();
+	});
+
+	return image.textureId;
+}
+
+void TextureLoader::Finish()
+{
+	std::unique_lock<std::mutex> lock(mutex);
+	while (pending > 0)
+	{
+		decoded.wait(lock, [this] { return !completed.empty(); });
+		DecodedImage image = std::move(completed.front());
+		completed.pop_front();
+		pending--;
+
+		// upload outside the lock so workers can keep queueing results
+		lock.unlock();
+		uploadedBytes += Complete(image);
+		lock.lock();
+	}
+}
+
+void TextureLoader::Poll(const size_t maxUploads)
+{
+	// once the frame's upload budget is spent the rest waits for the next Poll, the first image always goes so loading makes progress
+	std::unique_lock<std::mutex> lock(mutex);
+	for (size_t uploads = 0; uploads < maxUploads && !completed.empty() && (uploads == 0 || TextureUploadRing::Get().HasFrameBudget()); uploads++)
+	{
+		DecodedImage image = std::move(completed.front());
+		completed.pop_front();
+		pending--;
+
+		lock.unlock();
+		uploadedBytes += Complete(image);
+		lock.lock();
+	}
+}
+
+bool TextureLoader::Idle()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	return pending == 0;
+}
+
+unsigned int TextureLoader::LoadImmediate(const std::string& filename, const bool srgb)
+{
+	DecodedImage image{};
+	glGenTextures(1, &image.textureId);
+	image.filename = filename;
+	image.srgb = srgb;
+	Decode(image, SupportsCookedTextures());
+	Upload(image);
+	return image.textureId;
+}
+
+bool TextureLoader::SupportsCookedTextures()
+{
+	static const bool supported = []
+	{
+		GLint count = 0;
+		glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+		for (GLint i = 0; i < count; i++)
+		{
+			const char* extension = reinterpret_cast<const char*>(glGetStringi(GL_EXTENSIONS, i));
+			if (extension && std::strcmp(extension, "GL_EXT_texture_compression_s3tc") == 0)
+				return true;
+		}
+		return false;
+	}();
+	return supported;
+}
+
+void TextureLoader::Decode(DecodedImage& image, const bool useCooked)
+{
+	// The source is mapped once for both the cook hash and the decoder, stb reads straight from the page cache
+	// instead of copying the file through its stdio buffer
+	const MappedFile source(image.filename);
+	if (!source.IsOpen())
+		return;
+	if (!useCooked || !TextureCooker::Load(image.filename, HashBytes(source.Data(), source.Size()), image.srgb, image.compressed))
+	{
+		image.data = stbi_load_from_memory(source.Data(), static_cast<int>(source.Size()), &image.width, &image.height, &image.numComponents, 4);
+		if (image.data)
+			image.mips = GenerateMipChain(image.data, image.width, image.height, image.srgb);
+	}
+
+	// the streamer keeps every level in system memory, they move into its format here rather than on the GL thread
+	if (image.stream && (image.data || !image.compressed.mips.empty()))
+	{
+		StreamedImage& streamed = image.streamed;
+		streamed.srgb = image.srgb;
+		if (!image.compressed.mips.empty())
+		{
+			streamed.srgb = image.compressed.srgb;
+			streamed.compressed = true;
+			streamed.format = image.compressed.format;
+			for (CompressedMip& mip : image.compressed.mips)
+				streamed.levels.push_back(StreamedLevel{ mip.width, mip.height, std::move(mip.data) });
+			image.compressed.mips.clear();
+			return;
+		}
+
+		const size_t baseBytes = static_cast<size_t>(image.width) * image.height * 4;
+		streamed.levels.push_back(StreamedLevel{ image.width, image.height, std::vector<unsigned char>(image.data, image.data + baseBytes) });
+		for (MipLevel& mip : image.mips)
+			streamed.levels.push_back(StreamedLevel{ mip.width, mip.height, std::move(mip.rgba) });
+		image.mips.clear();
+		stbi_image_free(image.data);
+		image.data = nullptr;
+	}
+}
+
+size_t TextureLoader::Complete(DecodedImage& image)
+{
+	if (!image.streamed.levels.empty())
+		return TextureStreamer::Get().Add(image.textureId, std::move(image.streamed));
+	return Upload(image);
+}
+
+size_t TextureLoader::Upload(const DecodedImage& image)
+{
+	size_t bytes = 0;
+	if (!image.compressed.mips.empty())
+	{
+		// every level was cooked offline, so there is nothing left for the driver to generate
+		const std::vector<CompressedMip>& mips = image.compressed.mips;
+		GLState::Get().BindTexture(image.textureId);
+		for (size_t level = 0; level < mips.size(); level++)
+		{
+			TextureUploadRing::Get().UploadCompressedLevel(static_cast<GLint>(level), image.compressed.format, image.compressed.srgb, mips[level].width,
+				mips[level].height, mips[level].data.data());
+			bytes += mips[level].data.size();
+		}
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, static_cast<GLint>(mips.size() - 1));
+
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		return bytes;
+	}
+
+	if (image.data)
+	{
+		// the mip chain was built on the worker, so the driver doesn't have to generate one here
+		const GLenum internalFormat = image.srgb ? GL_SRGB8_ALPHA8 : GL_RGBA8;
+		GLState::Get().BindTexture(image.textureId);
+		TextureUploadRing::Get().UploadLevel(0, internalFormat, image.width, image.height, image.data);
+		bytes = static_cast<size_t>(image.width) * image.height * 4;
+		for (size_t level = 0; level < image.mips.size(); level++)
+		{
+			const MipLevel& mip = image.mips[level];
+			TextureUploadRing::Get().UploadLevel(static_cast<GLint>(level + 1), internalFormat, mip.width, mip.height, mip.rgba.data());
+			bytes += mip.rgba.size();
+		}
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, static_cast<GLint>(image.mips.size()));
+
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	}
+	else
+	{
+		std::cout << "Texture failed to load at path: " << image.filename << std::endl;
+	}
+	stbi_image_free(image.data);
+	return bytes;
+}
@@ -0,0 +1,77 @@
+#pragma once
+#include "MipGenerator.h"
+#include "TextureCompression.h"
+#include "TextureStreamer.h"
+#include "ThreadPool.h"
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+
+// Decodes image files and builds their mip chains on worker threads, then uploads the results level by level on
+// the GL thread. Images with an up to date cooked file (see TextureCooker) are uploaded block compressed with their stored mips
+// instead, as long as useCooked is set and the driver supports the formats. With stream set the chains are handed to
+// TextureStreamer instead, which only uploads their small levels until draws ask for more.
+// The loader must be created and used from the thread that owns the GL context.
+class TextureLoader
+{
+public:
+	explicit TextureLoader(ThreadPool& pool = ThreadPool::Shared(), bool useCooked = true, bool stream = false);
+	~TextureLoader();
+
+	TextureLoader(const TextureLoader&) = delete;
+	TextureLoader& operator=(const TextureLoader&) = delete;
+
+	// Reserves the texture name right away so it can be stored in a Mesh, the pixels arrive with Finish or Poll.
+	// Until then the texture holds a single grey texel so it can already be sampled. srgb marks color data: its mips
+	// are filtered in linear light and it is stored in an sRGB format, so sampling returns linear values.
+	unsigned int Load(const std::string& filename, bool srgb = false);
+
+	// Uploads images as their decodes complete and returns once every queued texture is uploaded
+	void Finish();
+
+	// Uploads at most maxUploads images that have already been decoded without waiting for the rest,
+	// fewer once the frame budget of TextureUploadRing is spent
+	void Poll(size_t maxUploads);
+
+	// True once every queued texture has been uploaded
+	bool Idle();
+
+	// Serial decode and upload on the calling thread
+	static unsigned int LoadImmediate(const std::string& filename, bool srgb = false);
+
+	// texture memory of everything uploaded so far, mip chains included. Streamed textures count with their tail only.
+	size_t UploadedBytes() const { return uploadedBytes; }
+
+	// S3TC comes from an extension even on GL 3.3 drivers, BC5 is core
+	static bool SupportsCookedTextures();
+
+private:
+	struct DecodedImage
+	{
+		unsigned int textureId;
+		std::string filename;
+		bool srgb;
+		bool stream;
+		int width, height, numComponents;
+		unsigned char* data; // RGBA8
+		std::vector<MipLevel> mips;
+		CompressedImage compressed; // has mips when a cooked file was used instead of the source
+		StreamedImage streamed;     // takes over the levels of either of the above when the image is streamed
+	};
+
+	ThreadPool& pool;
+	bool useCooked;
+	bool stream;
+	size_t uploadedBytes = 0;
+	std::mutex mutex;
+	std::condition_variable decoded;
+	std::deque<DecodedImage> completed;
+	size_t pending = 0;
+
+	static void Decode(DecodedImage& image, bool useCooked);
+	// returns the texture memory the upload takes
+	static size_t Upload(const DecodedImage& image);
+	static size_t Complete(DecodedImage& image);
+};
@@ -0,0 +1,271 @@
+#include "TextureStreamer.h"
+#include "GLExtensions.h"
+#include "GLState.h"
+#include "TextureUploadRing.h"
+
+#include <algorithm>
+#include <glad/glad.h>
+
+TextureStreamer& TextureStreamer::Get()
+{
+	static TextureStreamer streamer;
+	return streamer;
+}
+
+size_t TextureStreamer::Add(const unsigned int textureId, StreamedImage image)
+{
+	Remove(textureId);
+	if (image.levels.empty())
+		return 0;
+
+	StreamedTexture texture{};
+	texture.textureId = textureId;
+	texture.image = std::move(image);
+	const std::vector<StreamedLevel>& levels = texture.image.levels;
+	texture.tailLevel = levels.size() - 1;
+	while (texture.tailLevel > 0 && std::max(levels[texture.tailLevel - 1].width, levels[texture.tailLevel - 1].height) <= TAIL_SIZE)
+		texture.tailLevel--;
+	texture.residentLevel = levels.size();
+	texture.wantedLevel = texture.tailLevel;
+
+	StreamedTexture& added = textures.emplace(textureId, std::move(texture)).first->second;
+	MakeResident(added, added.tailLevel);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	return ChainBytes(added.image, added.tailLevel);
+}
+
+void TextureStreamer::Remove(const unsigned int textureId)
+{
+	const auto found = textures.find(textureId);
+	if (found == textures.end())
+		return;
+	residentBytes -= ChainBytes(found->second.image, found->second.residentLevel);
+	textures.erase(found);
+}
+
+void TextureStreamer::Request(const unsigned int textureId, const float pixels)
+{
+	const auto found = textures.find(textureId);
+	if (found == textures.end())
+		return;
+	StreamedTexture& texture = found->second;
+
+	// the coarsest level that still has a texel for every pixel
+	const std::vector<StreamedLevel>& levels = texture.image.levels;
+	size_t level = texture.tailLevel;
+	while (level > 0 && static_cast<float>(std::max(levels[level].width, levels[level].height)) < pixels)
+		level--;
+
+	if (texture.lastUsedFrame != frame)
+	{
+		texture.lastUsedFrame = frame;
+		texture.wantedLevel = level;
+	}
+	else
+	{
+		texture.wantedLevel = std::min(texture.wantedLevel, level);
+	}
+
+	if (texture.wantedLevel < texture.residentLevel && !texture.waiting)
+	{
+		texture.waiting = true;
+		texture.requestTime = std::chrono::steady_clock::now();
+	}
+}
+
+void TextureStreamer::Update(const size_t maxUploads)
+{
+	std::vector<StreamedTexture*> wanting;
+	for (auto& entry : textures)
+	{
+		StreamedTexture& texture = entry.second;
+		// a request that went away or got coarser before it was served doesn't count towards the latency
+		if (texture.lastUsedFrame != frame || texture.wantedLevel >= texture.residentLevel)
+			texture.waiting = false;
+		else
+			wanting.push_back(&texture);
+	}
+
+	// the textures furthest from what they need go first, each gets one level per frame so all of them sharpen together
+	std::sort(wanting.begin(), wanting.end(), [](const StreamedTexture* a, const StreamedTexture* b)
+	{
+		return a->residentLevel - a->wantedLevel > b->residentLevel - b->wantedLevel;
+	});
+
+	size_t uploadsLeft = maxUploads;
+	for (StreamedTexture* texture : wanting)
+	{
+		if (uploadsLeft == 0 || (uploadsLeft < maxUploads && !TextureUploadRing::Get().HasFrameBudget()))
+			break;
+
+		const size_t level = texture->residentLevel - 1;
+		const size_t extraBytes = texture->image.levels[level].data.size();
+		// nothing is given up unless it makes enough room
+		if (residentBytes + extraBytes > budgetBytes + EvictableBytes(texture))
+			continue;
+		while (residentBytes + extraBytes > budgetBytes)
+		{
+			StreamedTexture* victim = FindVictim(texture);
+			MakeResident(*victim, victim->residentLevel + 1);
+			evictions++;
+		}
+
+		MakeResident(*texture, level);
+		uploads++;
+		uploadsLeft--;
+		if (texture->waiting && texture->residentLevel <= texture->wantedLevel)
+		{
+			const double latencyMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - texture->requestTime).count();
+			texture->waiting = false;
+			completedRequests++;
+			totalLatencyMs += latencyMs;
+			maxLatencyMs = std::max(maxLatencyMs, latencyMs);
+		}
+	}
+
+	frame++;
+}
+
+TextureStreamingStats TextureStreamer::GetStats() const
+{
+	TextureStreamingStats stats;
+	stats.textures = textures.size();
+	stats.budgetBytes = budgetBytes;
+	stats.residentBytes = residentBytes;
+	for (const auto& entry : textures)
+	{
+		const StreamedTexture& texture = entry.second;
+		stats.fullBytes += ChainBytes(texture.image, 0);
+		stats.residentLevels += texture.image.levels.size() - texture.residentLevel;
+		stats.totalLevels += texture.image.levels.size();
+		if (texture.waiting)
+			stats.waitingTextures++;
+	}
+	stats.uploads = uploads;
+	stats.evictions = evictions;
+	stats.averageLatencyMs = completedRequests ? totalLatencyMs / static_cast<double>(completedRequests) : 0.0;
+	stats.maxLatencyMs = maxLatencyMs;
+	return stats;
+}
+
+TextureStreamer::StreamedTexture* TextureStreamer::FindVictim(const StreamedTexture* protect)
+{
+	// textures not drawn this frame go first, oldest first, then those drawn sharper than they needed to be.
+	// A texture is never taken below what was asked for this frame, so two of them can't evict each other forever.
+	StreamedTexture* victim = nullptr;
+	for (auto& entry : textures)
+	{
+		StreamedTexture& texture = entry.second;
+		if (&texture == protect || texture.residentLevel >= texture.tailLevel)
+			continue;
+		const bool unused = texture.lastUsedFrame != frame;
+		if (!unused && texture.residentLevel >= texture.wantedLevel)
+			continue;
+
+		if (!victim)
+		{
+			victim = &texture;
+			continue;
+		}
+		const bool victimUnused = victim->lastUsedFrame != frame;
+		if (unused != victimUnused ? unused : texture.lastUsedFrame < victim->lastUsedFrame)
+			victim = &texture;
+	}
+	return victim;
+}
+
+size_t TextureStreamer::EvictableBytes(const StreamedTexture* protect) const
+{
+	// the levels FindVictim would hand out before it runs dry
+	size_t bytes = 0;
+	for (const auto& entry : textures)
+	{
+		const StreamedTexture& texture = entry.second;
+		if (&texture == protect)
+			continue;
+		const size_t floor = texture.lastUsedFrame != frame ? texture.tailLevel : std::min(texture.wantedLevel, texture.tailLevel);
+		for (size_t level = texture.residentLevel; level < floor; level++)
+			bytes += texture.image.levels[level].data.size();
+	}
+	return bytes;
+}
+
+void TextureStreamer::MakeResident(StreamedTexture& texture, const size_t level)
+{
+	const StreamedImage& image = texture.image;
+	const size_t count = image.levels.size();
+	// first of the levels resident both before and after
+	const size_t kept = std::max(level, texture.residentLevel);
+	GLState& state = GLState::Get();
+
+	// respecifying the texture drops its contents, so the kept levels wait in a scratch texture meanwhile
+	unsigned int scratch = 0;
+	if (GLExt::CopyImageSubData && kept < count)
+	{
+		glGenTextures(1, &scratch);
+		state.BindTexture(scratch);
+		Allocate(image, kept, count);
+		for (size_t source = kept; source < count; source++)
+		{
+			const StreamedLevel& mip = image.levels[source];
+			GLExt::CopyImageSubData(texture.textureId, GL_TEXTURE_2D, static_cast<GLint>(source - texture.residentLevel), 0, 0, 0, scratch,
+				GL_TEXTURE_2D, static_cast<GLint>(source - kept), 0, 0, 0, mip.width, mip.height, 1);
+		}
+	}
+
+	state.BindTexture(texture.textureId);
+	Allocate(image, level, texture.residentLevel);
+	TextureUploadRing& ring = TextureUploadRing::Get();
+	for (size_t source = level; source < count; source++)
+	{
+		const StreamedLevel& mip = image.levels[source];
+		const auto target = static_cast<GLint>(source - level);
+		if (scratch && source >= kept)
+			GLExt::CopyImageSubData(scratch, GL_TEXTURE_2D, static_cast<GLint>(source - kept), 0, 0, 0, texture.textureId, GL_TEXTURE_2D, target,
+				0, 0, 0, mip.width, mip.height, 1);
+		else if (image.compressed)
+			ring.UpdateCompressedLevel(target, image.format, image.srgb, mip.width, mip.height, mip.data.data());
+		else
+			ring.UpdateLevel(target, mip.width, mip.height, mip.data.data());
+	}
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, static_cast<GLint>(count - 1 - level));
+	if (scratch)
+		state.DeleteTexture(scratch);
+
+	residentBytes = residentBytes - ChainBytes(image, texture.residentLevel) + ChainBytes(image, level);
+	texture.residentLevel = level;
+}
+
+void TextureStreamer::Allocate(const StreamedImage& image, const size_t firstLevel, const size_t previousLevel)
+{
+	TextureUploadRing& ring = TextureUploadRing::Get();
+	const size_t count = image.levels.size();
+	for (size_t source = firstLevel; source < count; source++)
+	{
+		const StreamedLevel& mip = image.levels[source];
+		const auto target = static_cast<GLint>(source - firstLevel);
+		if (image.compressed)
+			ring.AllocateCompressedLevel(target, image.format, image.srgb, mip.width, mip.height);
+		else
+			ring.AllocateLevel(target, image.srgb ? GL_SRGB8_ALPHA8 : GL_RGBA8, mip.width, mip.height);
+	}
+	// a texture that got coarser still has its finest levels at the end, an empty image frees them
+	for (size_t target = count - firstLevel; target < count - std::min(previousLevel, count); target++)
+	{
+		if (image.compressed)
+			ring.AllocateCompressedLevel(static_cast<GLint>(target), image.format, image.srgb, 0, 0);
+		else
+			ring.AllocateLevel(static_cast<GLint>(target), image.srgb ? GL_SRGB8_ALPHA8 : GL_RGBA8, 0, 0);
+	}
+}
+
+size_t TextureStreamer::ChainBytes(const StreamedImage& image, const size_t firstLevel)
+{
+	size_t bytes = 0;
+	for (size_t level = firstLevel; level < image.levels.size(); level++)
+		bytes += image.levels[level].data.size();
+	return bytes;
+}
@@ -0,0 +1,109 @@
+#pragma once
+#include "TextureCompression.h"
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+// One mip level kept in system memory, RGBA8 texels or compressed blocks
+struct StreamedLevel
+{
+	int width, height;
+	std::vector<unsigned char> data;
+};
+
+struct StreamedImage
+{
+	bool compressed = false;
+	BlockFormat format = BlockFormat::BC1; // only meaningful when compressed
+	bool srgb = false;
+	std::vector<StreamedLevel> levels; // the full chain, largest level first
+};
+
+struct TextureStreamingStats
+{
+	size_t textures = 0;
+	size_t budgetBytes = 0;
+	size_t residentBytes = 0;
+	size_t fullBytes = 0;       // texture memory if every level of every streamed texture were resident
+	size_t residentLevels = 0;
+	size_t totalLevels = 0;
+	size_t waitingTextures = 0; // textures still below the resolution they were last asked for
+	size_t uploads = 0;         // levels streamed in so far
+	size_t evictions = 0;       // levels dropped to stay within the budget
+	double averageLatencyMs = 0.0; // from the first request for a level until it is resident
+	double maxLatencyMs = 0.0;
+};
+
+// Keeps the whole mip chain of streamed textures in system memory and only the levels that are needed on screen in
+// texture memory. A texture starts out with its small tail levels so it can be drawn right away, finer levels follow
+// one at a time as draws ask for them, and the least recently used ones are dropped again to stay within the budget.
+// GL level 0 holds the finest resident level, so a texture only has storage for the levels that are resident and the
+// budget counts exactly what is allocated. Changing the residency respecifies the texture from the new finest level:
+// the levels it keeps are copied on the GPU where glCopyImageSubData is available and only new levels are uploaded.
+// Like the rest of the GL resources it may only be used from the thread that owns the context.
+class TextureStreamer
+{
+public:
+	static TextureStreamer& Get();
+
+	// levels up to this size on their longest side are uploaded right away and never evicted
+	static const int TAIL_SIZE = 64;
+
+	void SetBudget(size_t bytes) { budgetBytes = bytes; }
+	size_t GetBudget() const { return budgetBytes; }
+
+	// Takes over the chain of textureId and uploads its tail, returns the bytes uploaded
+	size_t Add(unsigned int textureId, StreamedImage image);
+	// Forgets the texture, called by TextureCache before it deletes one
+	void Remove(unsigned int textureId);
+	bool IsStreamed(const unsigned int textureId) const { return textures.count(textureId) != 0; }
+
+	// Asks for the texture to be sharp when its largest level spans the given number of pixels on screen.
+	// Called while drawing, the finest request of a frame wins. Textures that aren't streamed are ignored.
+	void Request(unsigned int textureId, float pixels);
+
+	// Call once per frame after drawing: streams at most maxUploads levels in, fewer once the frame budget of
+	// TextureUploadRing is spent, evicting least recently used levels when the memory budget would be exceeded
+	void Update(size_t maxUploads = 4);
+
+	TextureStreamingStats GetStats() const;
+
+private:
+	struct StreamedTexture
+	{
+		unsigned int textureId;
+		StreamedImage image;
+		size_t tailLevel;     // finest of the levels that always stay resident
+		size_t residentLevel; // finest level in texture memory
+		size_t wantedLevel;   // finest level asked for in lastUsedFrame
+		uint64_t lastUsedFrame;
+		bool waiting;
+		std::chrono::steady_clock::time_point requestTime;
+	};
+
+	std::unordered_map<unsigned int, StreamedTexture> textures;
+	size_t budgetBytes = 256 * 1024 * 1024;
+	size_t residentBytes = 0;
+	uint64_t frame = 1;
+	size_t uploads = 0;
+	size_t evictions = 0;
+	size_t completedRequests = 0;
+	double totalLatencyMs = 0.0;
+	double maxLatencyMs = 0.0;
+
+	TextureStreamer() = default;
+
+	// the least recently used texture that can give up a level for the texture in protect, nullptr if none can
+	StreamedTexture* FindVictim(const StreamedTexture* protect);
+	// bytes FindVictim could free for protect this frame
+	size_t EvictableBytes(const StreamedTexture* protect) const;
+	// Respecifies the texture with the levels from level on, keeping the contents of those that were resident
+	void MakeResident(StreamedTexture& texture, size_t level);
+	// Allocates the levels from firstLevel on at GL levels from 0 in the bound texture and frees the GL levels past
+	// them that held the levels from previousLevel on
+	static void Allocate(const StreamedImage& image, size_t firstLevel, size_t previousLevel);
+	static size_t ChainBytes(const StreamedImage& image, size_t firstLevel);
+};
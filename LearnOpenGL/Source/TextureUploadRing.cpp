@@ -0,0 +1,163 @@
+#include "TextureUploadRing.h"
+#include "GLState.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+TextureUploadRing& TextureUploadRing::Get()
+{
+	static TextureUploadRing ring;
+	return ring;
+}
+
+void TextureUploadRing::UploadLevel(const GLint level, const GLenum internalFormat, const int width, const int height, const unsigned char* rgba)
+{
+	const size_t rowBytes = static_cast<size_t>(width) * 4;
+	if (rowBytes * height <= SLOT_BYTES)
+	{
+		Slot& slot = Stage(rgba, rowBytes * height);
+		glTexImage2D(GL_TEXTURE_2D, level, internalFormat, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+		Retire(slot);
+		return;
+	}
+
+	AllocateLevel(level, internalFormat, width, height);
+	UpdateLevel(level, width, height, rgba);
+}
+
+void TextureUploadRing::UpdateLevel(const GLint level, const int width, const int height, const unsigned char* rgba)
+{
+	// a band of rows per slot
+	const size_t rowBytes = static_cast<size_t>(width) * 4;
+	const int bandRows = static_cast<int>(std::max<size_t>(SLOT_BYTES / rowBytes, 1));
+	for (int y = 0; y < height; y += bandRows)
+	{
+		const int rows = std::min(bandRows, height - y);
+		Slot& slot = Stage(rgba + y * rowBytes, rows * rowBytes);
+		glTexSubImage2D(GL_TEXTURE_2D, level, 0, y, width, rows, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+		Retire(slot);
+	}
+}
+
+void TextureUploadRing::UploadCompressedLevel(const GLint level, const BlockFormat format, const bool srgb, const int width, const int height,
+	const unsigned char* blocks)
+{
+	const GLenum internalFormat = GlInternalFormat(format, srgb);
+	const size_t bytes = CompressedSize(width, height, format);
+	if (bytes <= SLOT_BYTES)
+	{
+		Slot& slot = Stage(blocks, bytes);
+		glCompressedTexImage2D(GL_TEXTURE_2D, level, internalFormat, width, height, 0, static_cast<GLsizei>(bytes), nullptr);
+		Retire(slot);
+		return;
+	}
+
+	AllocateCompressedLevel(level, format, srgb, width, height);
+	UpdateCompressedLevel(level, format, srgb, width, height, blocks);
+}
+
+void TextureUploadRing::UpdateCompressedLevel(const GLint level, const BlockFormat format, const bool srgb, const int width, const int height,
+	const unsigned char* blocks)
+{
+	// bands are whole rows of 4x4 blocks, only the last one may end at the edge of the image
+	const GLenum internalFormat = GlInternalFormat(format, srgb);
+	const size_t blockRowBytes = static_cast<size_t>((width + 3) / 4) * BlockBytes(format);
+	const int bandRows = static_cast<int>(std::max<size_t>(SLOT_BYTES / blockRowBytes, 1)) * 4;
+	for (int y = 0; y < height; y += bandRows)
+	{
+		const int rows = std::min(bandRows, height - y);
+		const size_t bandBytes = static_cast<size_t>((rows + 3) / 4) * blockRowBytes;
+		Slot& slot = Stage(blocks + y / 4 * blockRowBytes, bandBytes);
+		glCompressedTexSubImage2D(GL_TEXTURE_2D, level, 0, y, width, rows, internalFormat, static_cast<GLsizei>(bandBytes), nullptr);
+		Retire(slot);
+	}
+}
+
+void TextureUploadRing::AllocateLevel(const GLint level, const GLenum internalFormat, const int width, const int height)
+{
+	GLState::Get().BindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+	glTexImage2D(GL_TEXTURE_2D, level, internalFormat, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+}
+
+void TextureUploadRing::AllocateCompressedLevel(const GLint level, const BlockFormat format, const bool srgb, const int width, const int height)
+{
+	GLState::Get().BindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+	glCompressedTexImage2D(GL_TEXTURE_2D, level, GlInternalFormat(format, srgb), width, height, 0,
+		static_cast<GLsizei>(CompressedSize(width, height, format)), nullptr);
+}
+
+void TextureUploadRing::EndFrame()
+{
+	stats.maxFrameBytes = std::max(stats.maxFrameBytes, stats.frameBytes);
+	stats.frameBytes = 0;
+}
+
+void TextureUploadRing::Release()
+{
+	for (Slot& slot : slots)
+	{
+		if (slot.fence)
+			glDeleteSync(slot.fence);
+		if (slot.buffer)
+			GLState::Get().DeleteBuffer(slot.buffer);
+		slot = Slot();
+	}
+	nextSlot = 0;
+}
+
+TextureUploadRing::Slot& TextureUploadRing::Stage(const unsigned char* data, const size_t bytes)
+{
+	Slot& slot = slots[nextSlot];
+	nextSlot = (nextSlot + 1) % SLOT_COUNT;
+
+	if (!slot.buffer)
+	{
+		glGenBuffers(1, &slot.buffer);
+		GLState::Get().BindBuffer(GL_PIXEL_UNPACK_BUFFER, slot.buffer);
+		glBufferData(GL_PIXEL_UNPACK_BUFFER, SLOT_BYTES, nullptr, GL_STREAM_DRAW);
+	}
+	else
+	{
+		GLState::Get().BindBuffer(GL_PIXEL_UNPACK_BUFFER, slot.buffer);
+	}
+
+	if (slot.fence)
+	{
+		// the GPU may still be reading the previous contents, only wait when it actually is
+		if (glClientWaitSync(slot.fence, 0, 0) == GL_TIMEOUT_EXPIRED)
+		{
+			const auto start = std::chrono::steady_clock::now();
+			while (glClientWaitSync(slot.fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000) == GL_TIMEOUT_EXPIRED)
+			{
+			}
+			stats.stalls++;
+			stats.stallMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+		}
+		glDeleteSync(slot.fence);
+		slot.fence = nullptr;
+	}
+
+	// the fence already ordered us after the GPU, so the driver doesn't need to synchronize the mapping again
+	void* mapped = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, static_cast<GLsizeiptr>(bytes),
+		GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+	bool copied = false;
+	if (mapped)
+	{
+		std::memcpy(mapped, data, bytes);
+		copied = glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER) == GL_TRUE;
+	}
+	if (!copied)
+		glBufferSubData(GL_PIXEL_UNPACK_BUFFER, 0, static_cast<GLsizeiptr>(bytes), data);
+
+	stats.uploadedBytes += bytes;
+	stats.frameBytes += bytes;
+	stats.chunks++;
+	return slot;
+}
+
+void TextureUploadRing::Retire(Slot& slot)
+{
+	slot.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	GLState::Get().BindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+}
@@ -0,0 +1,73 @@
+#pragma once
+#include "TextureCompression.h"
+
+#include <cstddef>
+#include <glad/glad.h>
+
+struct TextureUploadStats
+{
+	size_t uploadedBytes = 0; // staged through the ring so far
+	size_t chunks = 0;        // slot fills, a level larger than a slot takes several
+	size_t stalls = 0;        // times every slot was still in flight and the GL thread had to wait
+	double stallMs = 0.0;
+	size_t frameBytes = 0;    // staged since the last EndFrame
+	size_t maxFrameBytes = 0; // most staged in one frame
+};
+
+// Ring of pixel unpack buffers that texture data is staged through. Each slot is filled through an unsynchronized
+// mapping and the texture command sources it from there, so the call returns without the driver copying client memory
+// first. A fence after each use tells when the GPU has consumed a slot, the ring only waits when it has gone all the
+// way around before that. Levels larger than a slot are sent in bands of rows.
+// Like the rest of the GL resources it may only be used from the thread that owns the context.
+class TextureUploadRing
+{
+public:
+	static TextureUploadRing& Get();
+
+	static const size_t SLOT_COUNT = 4;
+	static const size_t SLOT_BYTES = 4 * 1024 * 1024;
+
+	// Specifies one level of the texture bound to GL_TEXTURE_2D from RGBA8 texels
+	void UploadLevel(GLint level, GLenum internalFormat, int width, int height, const unsigned char* rgba);
+	// Specifies one level of the texture bound to GL_TEXTURE_2D from blocks in format
+	void UploadCompressedLevel(GLint level, BlockFormat format, bool srgb, int width, int height, const unsigned char* blocks);
+	// Allocate one level without contents, for textures that are filled later
+	void AllocateLevel(GLint level, GLenum internalFormat, int width, int height);
+	void AllocateCompressedLevel(GLint level, BlockFormat format, bool srgb, int width, int height);
+	// Replace the contents of an allocated level without respecifying it, so draws sampling the texture don't have to
+	// wait for a new image
+	void UpdateLevel(GLint level, int width, int height, const unsigned char* rgba);
+	void UpdateCompressedLevel(GLint level, BlockFormat format, bool srgb, int width, int height, const unsigned char* blocks);
+
+	// Bytes loaders may stage per frame before they leave the rest of their queue to the next one. Uploads that have
+	// started always finish, so the budget bounds how many textures start rather than cutting one in half.
+	void SetFrameBudget(size_t bytes) { frameBudget = bytes; }
+	size_t GetFrameBudget() const { return frameBudget; }
+	bool HasFrameBudget() const { return stats.frameBytes < frameBudget; }
+	// Call once per frame to reset the budget
+	void EndFrame();
+
+	const TextureUploadStats& GetStats() const { return stats; }
+
+	// Deletes the buffers and fences, call before the context goes away. The ring recreates them on the next upload.
+	void Release();
+
+private:
+	struct Slot
+	{
+		unsigned int buffer = 0;
+		GLsync fence = nullptr;
+	};
+
+	Slot slots[SLOT_COUNT];
+	size_t nextSlot = 0;
+	size_t frameBudget = 16 * 1024 * 1024;
+	TextureUploadStats stats;
+
+	TextureUploadRing() = default;
+
+	// Waits until the next slot is free, copies bytes into it and leaves it bound to GL_PIXEL_UNPACK_BUFFER
+	Slot& Stage(const unsigned char* data, size_t bytes);
+	// Fences the slot after the commands that read from it and unbinds it
+	void Retire(Slot& slot);
+};
@@ -0,0 +1,117 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed set of worker threads pulling tasks from a shared FIFO queue
+class ThreadPool
+{
+public:
+	explicit ThreadPool(const unsigned int threadCount = DefaultThreadCount())
+	{
+		for (unsigned int i = 0; i < threadCount; i++)
+			workers.emplace_back([this] { WorkerLoop(); });
+	}
+
+	~ThreadPool()
+	{
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			stopping = true;
+		}
+		wake.notify_all();
+		for (std::thread& worker : workers)
+			worker.join();
+	}
+
+	ThreadPool(const ThreadPool&) = delete;
+	ThreadPool& operator=(const ThreadPool&) = delete;
+
+	void Enqueue(std::function<void()> task)
+	{
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			tasks.push_back(std::move(task));
+		}
+		wake.notify_one();
+	}
+
+	// Splits [0, count) into one chunk per worker plus one for the calling thread and returns once all of them ran.
+	// Must not be called from a worker of the same pool, its chunks could end up queued behind the caller.
+	void ParallelFor(const size_t count, const std::function<void(size_t begin, size_t end)>& body)
+	{
+		const size_t chunks = std::min<size_t>(count, workers.size() + 1);
+		if (chunks <= 1)
+		{
+			if (count > 0)
+				body(0, count);
+			return;
+		}
+
+		std::mutex doneMutex;
+		std::condition_variable done;
+		size_t remaining = chunks - 1;
+		for (size_t chunk = 1; chunk < chunks; chunk++)
+		{
+			Enqueue([&, chunk]
+			{
+				body(count * chunk / chunks, count * (chunk + 1) / chunks);
+				// notify under the lock, the caller's stack goes away as soon as it sees the last chunk
+				std::lock_guard<std::mutex> lock(doneMutex);
+				if (--remaining == 0)
+					done.notify_one();
+			});
+		}
+		body(0, count / chunks);
+
+		std::unique_lock<std::mutex> lock(doneMutex);
+		done.wait(lock, [&] { return remaining == 0; });
+	}
+
+	unsigned int ThreadCount() const { return static_cast<unsigned int>(workers.size()); }
+
+	// leave one core for the GL thread
+	static unsigned int DefaultThreadCount()
+	{
+		const unsigned int cores = std::thread::hardware_concurrency();
+		return std::max(cores, 2u) - 1;
+	}
+
+	// process-wide pool shared by the asset loaders
+	static ThreadPool& Shared()
+	{
+		static ThreadPool pool;
+		return pool;
+	}
+
+private:
+	std::vector<std::thread> workers;
+	std::deque<std::function<void()>> tasks;
+	std::mutex mutex;
+	std::condition_variable wake;
+	bool stopping = false;
+
+	void WorkerLoop()
+	{
+		for (;;)
+		{
+			std::function<void()> task;
+			{
+				std::unique_lock<std::mutex> lock(mutex);
+				wake.wait(lock, [this] { return stopping || !tasks.empty(); });
+				if (stopping && tasks.empty())
+					return;
+				task = std::move(tasks.front());
+				tasks.pop_front();
+			}
+			task();
+		}
+	}
+};
+#endif